@@ -0,0 +1,210 @@
+/**
+ * @file microbench.cpp
+ * @brief Microbenchmarks of the runtime's hot helpers
+ *
+ * Each benchmark runs its body in batches sized to take about 10 ms. After
+ * a few warmup batches, the harness reports the mean and standard deviation
+ * of ns/op across the measured batches. Pass a substring to run only the
+ * benchmarks whose name contains it:
+ *
+ *     ./microbench            # everything
+ *     ./microbench find       # only environment lookups
+ *
+ * Numbers are only meaningful from an optimized build
+ * (-DCMAKE_BUILD_TYPE=Release).
+ */
+
+#include "value.hpp"
+#include "syntax.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Defined in evaluation.cpp
+Value addValues(const Value &, const Value &);
+int compareNumericValues(const Value &, const Value &);
+
+namespace {
+
+const int WARMUP_BATCHES = 3;
+const int MEASURED_BATCHES = 15;
+const double BATCH_NS = 1e7;
+
+// Keeps results alive so the compiler cannot drop the measured work
+volatile long sink;
+
+typedef void (*BenchBody)(long iterations);
+
+struct Benchmark {
+    const char *name;
+    BenchBody body;
+};
+
+double runBatch(BenchBody body, long iterations) {
+    auto start = std::chrono::steady_clock::now();
+    body(iterations);
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+void runBenchmark(const Benchmark &bench) {
+    long iterations = 1;
+    while (runBatch(bench.body, iterations) < BATCH_NS / 10 && iterations < (1L << 40)) {
+        iterations *= 2;
+    }
+    iterations = std::max(1L, static_cast<long>(iterations * (BATCH_NS / std::max(1.0, runBatch(bench.body, iterations)))));
+    for (int i = 0; i < WARMUP_BATCHES; ++i) {
+        runBatch(bench.body, iterations);
+    }
+    std::vector<double> per_op;
+    for (int i = 0; i < MEASURED_BATCHES; ++i) {
+        per_op.push_back(runBatch(bench.body, iterations) / iterations);
+    }
+    double mean = 0;
+    for (double x : per_op) mean += x;
+    mean /= per_op.size();
+    double variance = 0;
+    for (double x : per_op) variance += (x - mean) * (x - mean);
+    double stddev = std::sqrt(variance / (per_op.size() - 1));
+    std::printf("%-32s %10.2f ns/op  +- %6.2f  (%ld ops x %d)\n",
+                bench.name, mean, stddev, iterations, MEASURED_BATCHES);
+}
+
+// ----------------------------------------------------------------------------
+// Arithmetic
+// ----------------------------------------------------------------------------
+
+void addOperands(const Value &a, const Value &b, long iterations) {
+    for (long i = 0; i < iterations; ++i) {
+        Value sum = addValues(a, b);
+        sink = sum->v_type;
+    }
+}
+
+void addIntInt(long n) { addOperands(IntegerV(12345), IntegerV(678), n); }
+void addIntRational(long n) { addOperands(IntegerV(7), RationalV(1, 3), n); }
+void addRationalRational(long n) { addOperands(RationalV(2, 9), RationalV(5, 12), n); }
+void addIntReal(long n) { addOperands(IntegerV(3), RealV(0.25), n); }
+
+void compareOperands(const Value &a, const Value &b, long iterations) {
+    for (long i = 0; i < iterations; ++i) {
+        sink = compareNumericValues(a, b);
+    }
+}
+
+void compareIntInt(long n) { compareOperands(IntegerV(12345), IntegerV(678), n); }
+void compareIntRational(long n) { compareOperands(IntegerV(7), RationalV(22, 3), n); }
+void compareRationalRational(long n) { compareOperands(RationalV(2, 9), RationalV(5, 12), n); }
+
+// ----------------------------------------------------------------------------
+// Environments
+// ----------------------------------------------------------------------------
+
+// Chain of the given length whose oldest (deepest) binding is "target"
+Assoc envChain(int length) {
+    Assoc env = empty();
+    env = extend("target", IntegerV(1), env);
+    for (int i = 1; i < length; ++i) {
+        env = extend("var" + std::to_string(i), IntegerV(i), env);
+    }
+    return env;
+}
+
+void findInChain(int length, long iterations) {
+    Assoc env = envChain(length);
+    const std::string name = "target";
+    for (long i = 0; i < iterations; ++i) {
+        Value v = find(name, env);
+        sink = v->v_type;
+    }
+}
+
+void find1(long n) { findInChain(1, n); }
+void find16(long n) { findInChain(16, n); }
+void find256(long n) { findInChain(256, n); }
+
+void extendFrames(long iterations) {
+    const std::string name = "x";
+    Value v = IntegerV(1);
+    Assoc base = envChain(8);
+    Assoc env = base;
+    for (long i = 0; i < iterations; ++i) {
+        // Restart every 64 frames so the chain and its teardown stay small
+        if ((i & 63) == 0) env = base;
+        env = extend(name, v, env);
+    }
+    sink = env.get() != nullptr;
+}
+
+// ----------------------------------------------------------------------------
+// Pairs
+// ----------------------------------------------------------------------------
+
+void pairCons(long iterations) {
+    Value car = IntegerV(1);
+    Value list = NullV();
+    for (long i = 0; i < iterations; ++i) {
+        if ((i & 1023) == 0) list = NullV();
+        list = PairV(car, list);
+    }
+    sink = list->v_type;
+}
+
+// ----------------------------------------------------------------------------
+// Reader
+// ----------------------------------------------------------------------------
+
+const char *READER_FORM =
+    "(define (fib n)\n"
+    "  ; naive recursion\n"
+    "  (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2)))))\n";
+
+void readForm(long iterations) {
+    std::string text;
+    for (int i = 0; i < 64; ++i) text += READER_FORM;
+    std::istringstream in(text);
+    for (long i = 0; i < iterations; ++i) {
+        if ((i & 63) == 0) {
+            in.clear();
+            in.seekg(0);
+        }
+        Syntax stx = readSyntax(in);
+        sink = stx.get() != nullptr;
+    }
+}
+
+const Benchmark BENCHMARKS[] = {
+    {"addValues/int+int", addIntInt},
+    {"addValues/int+rational", addIntRational},
+    {"addValues/rational+rational", addRationalRational},
+    {"addValues/int+real", addIntReal},
+    {"compareNumericValues/int,int", compareIntInt},
+    {"compareNumericValues/int,rat", compareIntRational},
+    {"compareNumericValues/rat,rat", compareRationalRational},
+    {"find/depth-1", find1},
+    {"find/depth-16", find16},
+    {"find/depth-256", find256},
+    {"extend", extendFrames},
+    {"PairV", pairCons},
+    {"readSyntax/define-form", readForm},
+};
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    const char *filter = argc > 1 ? argv[1] : "";
+#ifndef __OPTIMIZE__
+    std::printf("warning: unoptimized build; configure with -DCMAKE_BUILD_TYPE=Release\n");
+#endif
+    for (const Benchmark &bench : BENCHMARKS) {
+        if (std::strstr(bench.name, filter) != nullptr) {
+            runBenchmark(bench);
+        }
+    }
+    return 0;
+}
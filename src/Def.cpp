@@ -84,9 +84,10 @@ std::map<std::string, ExprType> primitives = {
  * - Control flow constructs: begin, quote
  * - Conditional : if, cond
  * - Function definition: lambda
- * - Variable and function definition: define
- * - Binding constructs: let, letrec
+ * - Variable and function definition: define, define-memoized
+ * - Binding constructs: let, letrec, let-values
  * - Assignment: set!
+ * - Record types: define-record-type
  * 
  * Note: and/or have been moved to primitives to support function-style usage
  * while maintaining their short-circuit evaluation behavior.
@@ -105,11 +106,111 @@ std::map<std::string, ExprType> reserved_words = {
 
     // Variable and function definition
     {"define",  E_DEFINE},   
+    {"define-memoized", E_DEFINE_MEMO},
 
     // Binding constructs
     {"let",     E_LET},      
     {"letrec",  E_LETREC},   
+    {"let-values", E_LET_VALUES},
     
     // Assignment
-    {"set!",    E_SET}      
+    {"set!",    E_SET},
+
+    // Record types
+    {"define-record-type", E_DEFINE_RECORD}
+};
+
+/**
+ * @brief Mapping of native library procedure names to expression types
+ *
+ * These procedures are implemented in C++ but, unlike primitives, they are
+ * ordinary library names: user code may shadow them with local bindings or
+ * redefine them at top level, which is common since most programs carry their
+ * own definitions of map and friends.
+ *
+ * Categories:
+ * - Higher-order list operations: map, for-each, filter, fold-left,
+ *   fold-right, reduce, apply
+ * - List library: length, append, reverse, list-ref, list-tail, memq,
+ *   member, assq, assoc, sort, list-sort
+ * - Memoization: memoize, memoize-stats
+ * - Structural equality: equal?
+ * - Strings: string-append, substring, string-length, string->symbol,
+ *   number->string
+ * - Exactness: exact->inexact, inexact->exact
+ * - Heap inspection: dump-heap, heap-live-bytes, heap-allocations
+ * - Timing: current-time-ns
+ */
+std::map<std::string, ExprType> library_procedures = {
+    // Higher-order list operations
+    {"map",        E_MAP},
+    {"for-each",   E_FOREACH},
+    {"filter",     E_FILTER},
+    {"fold-left",  E_FOLDL},
+    {"fold-right", E_FOLDR},
+    {"reduce",     E_REDUCE},
+    {"apply",      E_APPLYPROC},
+
+    // List library operations
+    {"length",     E_LENGTH},
+    {"append",     E_APPEND},
+    {"reverse",    E_REVERSE},
+    {"list-ref",   E_LISTREF},
+    {"list-tail",  E_LISTTAIL},
+    {"memq",       E_MEMQ},
+    {"member",     E_MEMBER},
+    {"assq",       E_ASSQ},
+    {"assoc",      E_ASSOC},
+    {"sort",       E_SORT},
+    {"list-sort",  E_LISTSORT},
+
+    // Memoization
+    {"memoize",       E_MEMOIZE},
+    {"memoize-stats", E_MEMOSTATS},
+
+    // Structural equality
+    {"equal?",        E_EQUALQ},
+
+    // String operations
+    {"string-append",  E_STRING_APPEND},
+    {"substring",      E_SUBSTRING},
+    {"string-length",  E_STRING_LENGTH},
+    {"string->symbol", E_STRING_TO_SYMBOL},
+    {"number->string", E_NUMBER_TO_STRING},
+
+    // Exactness conversions
+    {"exact->inexact", E_EXACT_TO_INEXACT},
+    {"inexact->exact", E_INEXACT_TO_EXACT},
+
+    // Heap inspection
+    {"dump-heap",      E_DUMP_HEAP},
+    {"heap-live-bytes", E_HEAP_LIVE_BYTES},
+    {"heap-allocations", E_HEAP_ALLOCATIONS},
+
+    // Timing
+    {"current-time-ns", E_CURRENT_TIME_NS},
+
+    // Multiple values
+    {"values",           E_VALUES},
+    {"call-with-values", E_CALL_WITH_VALUES},
+
+    // Evaluation of data
+    {"eval",                    E_EVAL},
+    {"interaction-environment", E_INTERACTION_ENV}
+};
+
+/**
+ * @brief Mapping of special forms that are not reserved words
+ *
+ * These forms have special syntax, but their names are common in user
+ * programs, so they stay ordinary identifiers: a form headed by one is
+ * parsed specially only where no lexical or global binding of the name is
+ * in scope.
+ *
+ * Categories:
+ * - Measurement: time
+ */
+std::map<std::string, ExprType> library_syntax = {
+    // Measurement
+    {"time",    E_TIME}
 };
@@ -20,6 +20,7 @@
 struct Syntax;
 struct Expr;
 struct Value;
+struct ValueBase;
 struct AssocList;
 struct Assoc;
 
@@ -33,6 +34,7 @@ enum ExprType {
     // Basic types and literals
     E_FIXNUM,          
     E_RATIONAL,        
+    E_REAL,
     E_STRING,         
     E_TRUE,            
     E_FALSE,           
@@ -89,6 +91,7 @@ enum ExprType {
     // Variables and function definition
     E_VAR,              
     E_APPLY,           
+    E_LIBRARY_CALL,
     E_LAMBDA,         
     E_DEFINE,          
 
@@ -101,6 +104,72 @@ enum ExprType {
 
     // I/O operations
     E_DISPLAY,         
+
+    // Higher-order list operations
+    E_MAP,
+    E_FOREACH,
+    E_FILTER,
+    E_FOLDL,
+    E_FOLDR,
+    E_REDUCE,
+    E_APPLYPROC,
+
+    // List library operations
+    E_LENGTH,
+    E_APPEND,
+    E_REVERSE,
+    E_LISTREF,
+    E_LISTTAIL,
+    E_MEMQ,
+    E_MEMBER,
+    E_ASSQ,
+    E_ASSOC,
+    E_SORT,
+    E_LISTSORT,
+
+    // Memoization
+    E_MEMOIZE,
+    E_MEMOSTATS,
+    E_DEFINE_MEMO,
+
+    // Structural equality
+    E_EQUALQ,
+
+    // String operations
+    E_STRING_APPEND,
+    E_SUBSTRING,
+    E_STRING_LENGTH,
+    E_STRING_TO_SYMBOL,
+    E_NUMBER_TO_STRING,
+
+    // Exactness conversions
+    E_EXACT_TO_INEXACT,
+    E_INEXACT_TO_EXACT,
+
+    // Heap inspection
+    E_DUMP_HEAP,
+    E_HEAP_LIVE_BYTES,
+    E_HEAP_ALLOCATIONS,
+
+    // Timing
+    E_TIME,
+    E_CURRENT_TIME_NS,
+
+    // Record types
+    E_DEFINE_RECORD,
+    E_RECORD_CONSTRUCT,
+    E_RECORD_PREDICATE,
+    E_RECORD_ACCESS,
+    E_RECORD_MODIFY,
+
+    // Multiple values
+    E_VALUES,
+    E_CALL_WITH_VALUES,
+    E_LET_VALUES,
+
+    // Evaluation of data
+    E_EVAL,
+    E_INTERACTION_ENV,
 };
 
 /**
@@ -112,12 +181,17 @@ enum ExprType {
 enum ValueType {
     V_INT,              
     V_RATIONAL,         
+    V_REAL,
     V_BOOL,             
     V_SYM,              
     V_NULL,             
     V_STRING,           
     V_PAIR,             
     V_PROC,             
+    V_PRIMITIVE,
+    V_RECORD,
+    V_VALUES,
+    V_ENVIRONMENT,
     V_VOID,            
     V_TERMINATE        
 };
@@ -12,24 +12,57 @@
 #include "expr.hpp"
 #include "RE.hpp"
 #include "syntax.hpp"
+#include "stats.hpp"
+#include "profile.hpp"
+#include "trace.hpp"
+#include "snapshot.hpp"
+#include "fuel.hpp"
+#include "heap.hpp"
 #include <cstring>
 #include <vector>
 #include <map>
 #include <climits>
 #include <algorithm>
+#include <iterator>
+#include <unordered_map>
+#include <unordered_set>
+#include <cmath>
+#include <sstream>
+#include <fstream>
+#include <chrono>
+#include <ctime>
+#include <cstdio>
 
 extern std::map<std::string, ExprType> primitives;
 extern std::map<std::string, ExprType> reserved_words;
+extern std::map<std::string, ExprType> library_procedures;
+extern std::map<std::string, ExprType> library_syntax;
 
 // Helper function to compute GCD (declared in expr.cpp)
 extern int gcd(int a, int b);
 
-// Helper function to add two values (integers or rationals)
+// Helper function to convert a number to double for inexact arithmetic.
+// Any operation with an inexact operand yields an inexact result.
+static double toDouble(const Value &v, const char *error) {
+    switch (v->v_type) {
+        case V_INT: return static_cast<Integer*>(v.get())->n;
+        case V_RATIONAL: {
+            Rational *r = static_cast<Rational*>(v.get());
+            return (double)r->numerator / r->denominator;
+        }
+        case V_REAL: return static_cast<Real*>(v.get())->x;
+        default: throw RuntimeError(error);
+    }
+}
+
+// Helper function to add two values (integers, rationals or reals)
 Value addValues(const Value &v1, const Value &v2) {
     if (v1->v_type == V_INT && v2->v_type == V_INT) {
         int n1 = dynamic_cast<Integer*>(v1.get())->n;
         int n2 = dynamic_cast<Integer*>(v2.get())->n;
         return IntegerV(n1 + n2);
+    } else if (v1->v_type == V_REAL || v2->v_type == V_REAL) {
+        return RealV(toDouble(v1, "Wrong typename in addition") + toDouble(v2, "Wrong typename in addition"));
     } else if (v1->v_type == V_RATIONAL && v2->v_type == V_RATIONAL) {
         Rational* r1 = dynamic_cast<Rational*>(v1.get());
         Rational* r2 = dynamic_cast<Rational*>(v2.get());
@@ -88,6 +121,8 @@ Value subtractValues(const Value &v1, const Value &v2) {
         int n1 = dynamic_cast<Integer*>(v1.get())->n;
         int n2 = dynamic_cast<Integer*>(v2.get())->n;
         return IntegerV(n1 - n2);
+    } else if (v1->v_type == V_REAL || v2->v_type == V_REAL) {
+        return RealV(toDouble(v1, "Wrong typename in subtraction") - toDouble(v2, "Wrong typename in subtraction"));
     } else if (v1->v_type == V_RATIONAL && v2->v_type == V_RATIONAL) {
         Rational* r1 = dynamic_cast<Rational*>(v1.get());
         Rational* r2 = dynamic_cast<Rational*>(v2.get());
@@ -146,6 +181,8 @@ Value multiplyValues(const Value &v1, const Value &v2) {
         int n1 = dynamic_cast<Integer*>(v1.get())->n;
         int n2 = dynamic_cast<Integer*>(v2.get())->n;
         return IntegerV(n1 * n2);
+    } else if (v1->v_type == V_REAL || v2->v_type == V_REAL) {
+        return RealV(toDouble(v1, "Wrong typename in multiplication") * toDouble(v2, "Wrong typename in multiplication"));
     } else if (v1->v_type == V_RATIONAL && v2->v_type == V_RATIONAL) {
         Rational* r1 = dynamic_cast<Rational*>(v1.get());
         Rational* r2 = dynamic_cast<Rational*>(v2.get());
@@ -215,6 +252,10 @@ Value divideValues(const Value &v1, const Value &v2) {
         }
         if (n2 == 1) return IntegerV(n1);
         return RationalV(n1, n2);
+    } else if (v1->v_type == V_REAL || v2->v_type == V_REAL) {
+        // Only an exact zero divisor is an error; 0.0 follows IEEE rules
+        if (v2->v_type == V_INT && dynamic_cast<Integer*>(v2.get())->n == 0) throw RuntimeError("Division by zero");
+        return RealV(toDouble(v1, "Wrong typename in division") / toDouble(v2, "Wrong typename in division"));
     } else if (v1->v_type == V_RATIONAL && v2->v_type == V_RATIONAL) {
         Rational* r1 = dynamic_cast<Rational*>(v1.get());
         Rational* r2 = dynamic_cast<Rational*>(v2.get());
@@ -271,42 +312,57 @@ Value divideValues(const Value &v1, const Value &v2) {
 }
 
 Value Fixnum::eval(Assoc &e) { // evaluation of a fixnum
+    EVAL_STATS_SCOPE();
     return IntegerV(n);
 }
 
 Value RationalNum::eval(Assoc &e) { // evaluation of a rational number
+    EVAL_STATS_SCOPE();
     return RationalV(numerator, denominator);
 }
 
+Value RealNum::eval(Assoc &e) { // evaluation of a decimal number
+    EVAL_STATS_SCOPE();
+    return RealV(x);
+}
+
 Value StringExpr::eval(Assoc &e) { // evaluation of a string
-    return StringV(s);
+    EVAL_STATS_SCOPE();
+    return StringV(text);
 }
 
 Value True::eval(Assoc &e) { // evaluation of #t
+    EVAL_STATS_SCOPE();
     return BooleanV(true);
 }
 
 Value False::eval(Assoc &e) { // evaluation of #f
+    EVAL_STATS_SCOPE();
     return BooleanV(false);
 }
 
 Value MakeVoid::eval(Assoc &e) { // (void)
+    EVAL_STATS_SCOPE();
     return VoidV();
 }
 
 Value Exit::eval(Assoc &e) { // (exit)
+    EVAL_STATS_SCOPE();
     return TerminateV();
 }
 
 Value Unary::eval(Assoc &e) { // evaluation of single-operator primitive
+    EVAL_STATS_SCOPE();
     return evalRator(rand->eval(e));
 }
 
 Value Binary::eval(Assoc &e) { // evaluation of two-operators primitive
+    EVAL_STATS_SCOPE();
     return evalRator(rand1->eval(e), rand2->eval(e));
 }
 
 Value Variadic::eval(Assoc &e) { // evaluation of multi-operator primitive
+    EVAL_STATS_SCOPE();
     std::vector<Value> args;
     for (const auto &expr : rands) {
         args.push_back(expr->eval(e));
@@ -314,30 +370,154 @@ Value Variadic::eval(Assoc &e) { // evaluation of multi-operator primitive
     return evalRator(args);
 }
 
+// Builds the operator node behind a first-class primitive. Its operands are
+// never evaluated: applyPrimitive hands argument values to evalRator directly.
+static Expr primitiveNode(ExprType op) {
+    Expr none(nullptr);
+    std::vector<Expr> nones;
+    switch (op) {
+        case E_PLUS: return Expr(new PlusVar(nones));
+        case E_MINUS: return Expr(new MinusVar(nones));
+        case E_MUL: return Expr(new MultVar(nones));
+        case E_DIV: return Expr(new DivVar(nones));
+        case E_MODULO: return Expr(new Modulo(none, none));
+        case E_EXPT: return Expr(new Expt(none, none));
+        case E_LT: return Expr(new LessVar(nones));
+        case E_LE: return Expr(new LessEqVar(nones));
+        case E_EQ: return Expr(new EqualVar(nones));
+        case E_GE: return Expr(new GreaterEqVar(nones));
+        case E_GT: return Expr(new GreaterVar(nones));
+        case E_CONS: return Expr(new Cons(none, none));
+        case E_CAR: return Expr(new Car(none));
+        case E_CDR: return Expr(new Cdr(none));
+        case E_LIST: return Expr(new ListFunc(nones));
+        case E_SETCAR: return Expr(new SetCar(none, none));
+        case E_SETCDR: return Expr(new SetCdr(none, none));
+        case E_NOT: return Expr(new Not(none));
+        case E_AND: return Expr(new AndVar(nones));
+        case E_OR: return Expr(new OrVar(nones));
+        case E_EQQ: return Expr(new IsEq(none, none));
+        case E_BOOLQ: return Expr(new IsBoolean(none));
+        case E_INTQ: return Expr(new IsFixnum(none));
+        case E_NULLQ: return Expr(new IsNull(none));
+        case E_PAIRQ: return Expr(new IsPair(none));
+        case E_PROCQ: return Expr(new IsProcedure(none));
+        case E_SYMBOLQ: return Expr(new IsSymbol(none));
+        case E_LISTQ: return Expr(new IsList(none));
+        case E_STRINGQ: return Expr(new IsString(none));
+        case E_VOID: return Expr(new MakeVoid());
+        case E_EXIT: return Expr(new Exit());
+        case E_DISPLAY: return Expr(new Display(none));
+        case E_MAP: return Expr(new MapFunc(nones));
+        case E_FOREACH: return Expr(new ForEach(nones));
+        case E_FILTER: return Expr(new Filter(none, none));
+        case E_FOLDL: return Expr(new FoldLeft(nones));
+        case E_FOLDR: return Expr(new FoldRight(nones));
+        case E_REDUCE: return Expr(new Reduce(nones));
+        case E_APPLYPROC: return Expr(new ApplyProc(nones));
+        case E_LENGTH: return Expr(new Length(none));
+        case E_APPEND: return Expr(new Append(nones));
+        case E_REVERSE: return Expr(new Reverse(none));
+        case E_LISTREF: return Expr(new ListRef(none, none));
+        case E_LISTTAIL: return Expr(new ListTail(none, none));
+        case E_MEMQ: return Expr(new Memq(none, none));
+        case E_MEMBER: return Expr(new Member(none, none));
+        case E_ASSQ: return Expr(new Assq(none, none));
+        case E_ASSOC: return Expr(new AssocFunc(none, none));
+        case E_SORT: return Expr(new Sort(none, none));
+        case E_LISTSORT: return Expr(new ListSort(none, none));
+        case E_MEMOIZE: return Expr(new Memoize(nones));
+        case E_MEMOSTATS: return Expr(new MemoStats(none));
+        case E_EQUALQ: return Expr(new IsEqual(none, none));
+        case E_STRING_APPEND: return Expr(new StringAppend(nones));
+        case E_SUBSTRING: return Expr(new Substring(nones));
+        case E_STRING_LENGTH: return Expr(new StringLength(none));
+        case E_STRING_TO_SYMBOL: return Expr(new StringToSymbol(none));
+        case E_NUMBER_TO_STRING: return Expr(new NumberToString(none));
+        case E_EXACT_TO_INEXACT: return Expr(new ExactToInexact(none));
+        case E_INEXACT_TO_EXACT: return Expr(new InexactToExact(none));
+        case E_DUMP_HEAP: return Expr(new DumpHeap(none));
+        case E_HEAP_LIVE_BYTES: return Expr(new HeapLiveBytes());
+        case E_HEAP_ALLOCATIONS: return Expr(new HeapAllocations());
+        case E_CURRENT_TIME_NS: return Expr(new CurrentTimeNs());
+        case E_VALUES: return Expr(new Values(nones));
+        case E_CALL_WITH_VALUES: return Expr(new CallWithValues(none, none));
+        case E_EVAL: return Expr(new Eval(nones));
+        case E_INTERACTION_ENV: return Expr(new InteractionEnv());
+        default: throw RuntimeError("Primitive cannot be used as a value");
+    }
+}
+
 Value Var::eval(Assoc &e) { // evaluation of variable
+    EVAL_STATS_SCOPE();
     Value matched_value = find(x, e);
     if (matched_value.get() == nullptr) {
+        // Primitive values are created once per name, so (eq? car car) holds
+        static std::map<std::string, Value> primitive_values;
+        auto cached = primitive_values.find(x);
+        if (cached != primitive_values.end()) {
+            return cached->second;
+        }
+        ExprType op;
         if (primitives.count(x)) {
-            return ProcedureV({}, Expr(new Var(x)), e);
+            op = primitives[x];
+        } else if (library_procedures.count(x)) {
+            op = library_procedures[x];
+        } else {
+            throw RuntimeError("Undefined variable: " + x);
         }
-        throw RuntimeError("Undefined variable: " + x);
+        Value prim = PrimitiveV(op, primitiveNode(op));
+        primitive_values.insert(std::make_pair(x, prim));
+        return prim;
     }
     return matched_value;
 }
 
+/**
+ * @brief Boxes the result of real arithmetic, reusing an operand box if it is free
+ *
+ * Binary::eval hands its operand temporaries over, so a real that nothing
+ * else refers to, such as the intermediate of (+ (* a b) c), can hold the
+ * result instead of a fresh allocation. Only the first operation of a chain
+ * over variables allocates.
+ */
+static Value realResult(const Value &rand1, const Value &rand2, double x) {
+    if (rand1.ptr.use_count() == 1) {
+        static_cast<Real*>(rand1.get())->x = x;
+        return rand1;
+    }
+    if (rand2.ptr.use_count() == 1) {
+        static_cast<Real*>(rand2.get())->x = x;
+        return rand2;
+    }
+    return RealV(x);
+}
+
 Value Plus::evalRator(const Value &rand1, const Value &rand2) { // +
+    if (rand1->v_type == V_REAL && rand2->v_type == V_REAL) {
+        return realResult(rand1, rand2, static_cast<Real*>(rand1.get())->x + static_cast<Real*>(rand2.get())->x);
+    }
     return addValues(rand1, rand2);
 }
 
 Value Minus::evalRator(const Value &rand1, const Value &rand2) { // -
+    if (rand1->v_type == V_REAL && rand2->v_type == V_REAL) {
+        return realResult(rand1, rand2, static_cast<Real*>(rand1.get())->x - static_cast<Real*>(rand2.get())->x);
+    }
     return subtractValues(rand1, rand2);
 }
 
 Value Mult::evalRator(const Value &rand1, const Value &rand2) { // *
+    if (rand1->v_type == V_REAL && rand2->v_type == V_REAL) {
+        return realResult(rand1, rand2, static_cast<Real*>(rand1.get())->x * static_cast<Real*>(rand2.get())->x);
+    }
     return multiplyValues(rand1, rand2);
 }
 
 Value Div::evalRator(const Value &rand1, const Value &rand2) { // /
+    if (rand1->v_type == V_REAL && rand2->v_type == V_REAL) {
+        return realResult(rand1, rand2, static_cast<Real*>(rand1.get())->x / static_cast<Real*>(rand2.get())->x);
+    }
     return divideValues(rand1, rand2);
 }
 
@@ -370,6 +550,8 @@ Value MinusVar::evalRator(const std::vector<Value> &args) { // - with multiple a
         } else if (args[0]->v_type == V_RATIONAL) {
             Rational* r = dynamic_cast<Rational*>(args[0].get());
             return RationalV(-r->numerator, r->denominator);
+        } else if (args[0]->v_type == V_REAL) {
+            return RealV(-dynamic_cast<Real*>(args[0].get())->x);
         }
         throw RuntimeError("Wrong typename");
     }
@@ -435,6 +617,9 @@ Value Expt::evalRator(const Value &rand1, const Value &rand2) { // expt
 
         return IntegerV((int)result);
     }
+    if (rand1->v_type == V_REAL || rand2->v_type == V_REAL) {
+        return RealV(pow(toDouble(rand1, "Wrong typename"), toDouble(rand2, "Wrong typename")));
+    }
     throw(RuntimeError("Wrong typename"));
 }
 
@@ -445,6 +630,11 @@ int compareNumericValues(const Value &v1, const Value &v2) {
         int n2 = dynamic_cast<Integer*>(v2.get())->n;
         return (n1 < n2) ? -1 : (n1 > n2) ? 1 : 0;
     }
+    else if (v1->v_type == V_REAL || v2->v_type == V_REAL) {
+        double x1 = toDouble(v1, "Wrong typename in numeric comparison");
+        double x2 = toDouble(v2, "Wrong typename in numeric comparison");
+        return (x1 < x2) ? -1 : (x1 > x2) ? 1 : 0;
+    }
     else if (v1->v_type == V_RATIONAL && v2->v_type == V_INT) {
         Rational* r1 = dynamic_cast<Rational*>(v1.get());
         int n2 = dynamic_cast<Integer*>(v2.get())->n;
@@ -579,11 +769,19 @@ Value Cdr::evalRator(const Value &rand) { // cdr
     return p->cdr;
 }
 
+// Advanced whenever a form parsed by eval may parse differently now: a
+// pair was mutated, or a new binding shadows a library procedure or form
+static unsigned long long eval_cache_epoch = 0;
+
 Value SetCar::evalRator(const Value &rand1, const Value &rand2) { // set-car!
     if (rand1->v_type != V_PAIR) {
         throw RuntimeError("set-car!: first argument must be a pair");
     }
     Pair* p = dynamic_cast<Pair*>(rand1.get());
+    if (p->constant) {
+        throw RuntimeError("set-car!: cannot mutate a quoted constant");
+    }
+    ++eval_cache_epoch;
     p->car = rand2;
     return VoidV();
 }
@@ -593,38 +791,122 @@ Value SetCdr::evalRator(const Value &rand1, const Value &rand2) { // set-cdr!
         throw RuntimeError("set-cdr!: first argument must be a pair");
     }
     Pair* p = dynamic_cast<Pair*>(rand1.get());
+    if (p->constant) {
+        throw RuntimeError("set-cdr!: cannot mutate a quoted constant");
+    }
+    ++eval_cache_epoch;
     p->cdr = rand2;
     return VoidV();
 }
 
-Value IsEq::evalRator(const Value &rand1, const Value &rand2) { // eq?
+// Identity comparison behind eq?, memq and assq. Symbols are interned, so
+// two symbols are eq? exactly when they are the same object.
+bool isEqValues(const Value &rand1, const Value &rand2) {
     // Check if type is Integer
     if (rand1->v_type == V_INT && rand2->v_type == V_INT) {
-        return BooleanV((dynamic_cast<Integer*>(rand1.get())->n) == (dynamic_cast<Integer*>(rand2.get())->n));
+        return (dynamic_cast<Integer*>(rand1.get())->n) == (dynamic_cast<Integer*>(rand2.get())->n);
     }
     // Check if type is Boolean
     else if (rand1->v_type == V_BOOL && rand2->v_type == V_BOOL) {
-        return BooleanV((dynamic_cast<Boolean*>(rand1.get())->b) == (dynamic_cast<Boolean*>(rand2.get())->b));
-    }
-    // Check if type is Symbol
-    else if (rand1->v_type == V_SYM && rand2->v_type == V_SYM) {
-        return BooleanV((dynamic_cast<Symbol*>(rand1.get())->s) == (dynamic_cast<Symbol*>(rand2.get())->s));
+        return (dynamic_cast<Boolean*>(rand1.get())->b) == (dynamic_cast<Boolean*>(rand2.get())->b);
     }
     // Check if type is Null or Void
     else if ((rand1->v_type == V_NULL && rand2->v_type == V_NULL) ||
              (rand1->v_type == V_VOID && rand2->v_type == V_VOID)) {
-        return BooleanV(true);
+        return true;
     } else {
-        return BooleanV(rand1.get() == rand2.get());
+        return rand1.get() == rand2.get();
+    }
+}
+
+// Compares two values that are not both pairs, for equal?
+static bool isEqualAtoms(ValueBase *a, ValueBase *b) {
+    if (a == b) return true;
+    if (a->v_type != b->v_type) return false;
+    switch (a->v_type) {
+        case V_INT:
+            return static_cast<Integer*>(a)->n == static_cast<Integer*>(b)->n;
+        case V_RATIONAL:
+            return static_cast<Rational*>(a)->numerator == static_cast<Rational*>(b)->numerator &&
+                   static_cast<Rational*>(a)->denominator == static_cast<Rational*>(b)->denominator;
+        case V_REAL:
+            return static_cast<Real*>(a)->x == static_cast<Real*>(b)->x;
+        case V_BOOL:
+            return static_cast<Boolean*>(a)->b == static_cast<Boolean*>(b)->b;
+        case V_STRING:
+            return static_cast<String*>(a)->str() == static_cast<String*>(b)->str();
+        case V_NULL:
+        case V_VOID:
+            return true;
+        default:
+            return false;
     }
 }
 
+struct PointerPairHash {
+    size_t operator()(const std::pair<ValueBase*, ValueBase*> &p) const {
+        return std::hash<ValueBase*>()(p.first) * 31 + std::hash<ValueBase*>()(p.second);
+    }
+};
+
+// Structural comparison behind equal?, member and assoc. The cdr spines of
+// both values are walked in a loop with Brent's cycle detection, which needs
+// no memory, and pairs of cars still to compare wait on an explicit work
+// list, so neither long nor deep structures consume native stack. Only car
+// comparisons past a budget are remembered in a hash set, which makes the
+// walk terminate when cars lead back into a cycle.
+bool isEqualValues(const Value &v1, const Value &v2) {
+    const size_t untracked_cars = 1024;
+    std::vector<std::pair<ValueBase*, ValueBase*>> work;
+    std::unordered_set<std::pair<ValueBase*, ValueBase*>, PointerPairHash> seen;
+    size_t cars = 0;
+    work.push_back(std::make_pair(v1.get(), v2.get()));
+    while (!work.empty()) {
+        ValueBase *a = work.back().first;
+        ValueBase *b = work.back().second;
+        work.pop_back();
+        ValueBase *mark_a = a, *mark_b = b;
+        size_t power = 1, length = 0;
+        while (a != b) {
+            if (a->v_type != V_PAIR || b->v_type != V_PAIR) {
+                if (!isEqualAtoms(a, b)) return false;
+                break;
+            }
+            ValueBase *car_a = static_cast<Pair*>(a)->car.get();
+            ValueBase *car_b = static_cast<Pair*>(b)->car.get();
+            if (car_a->v_type == V_PAIR && car_b->v_type == V_PAIR) {
+                if (car_a != car_b &&
+                    (++cars <= untracked_cars || seen.insert(std::make_pair(car_a, car_b)).second)) {
+                    work.push_back(std::make_pair(car_a, car_b));
+                }
+            } else if (!isEqualAtoms(car_a, car_b)) {
+                return false;
+            }
+            a = static_cast<Pair*>(a)->cdr.get();
+            b = static_cast<Pair*>(b)->cdr.get();
+            // Back at the mark: the rest of both spines repeats what was compared
+            if (a == mark_a && b == mark_b) break;
+            if (++length == power) {
+                mark_a = a;
+                mark_b = b;
+                power *= 2;
+                length = 0;
+            }
+        }
+    }
+    return true;
+}
+
+Value IsEq::evalRator(const Value &rand1, const Value &rand2) { // eq?
+    return BooleanV(isEqValues(rand1, rand2));
+}
+
 Value IsBoolean::evalRator(const Value &rand) { // boolean?
     return BooleanV(rand->v_type == V_BOOL);
 }
 
 Value IsFixnum::evalRator(const Value &rand) { // number?
-    return BooleanV(rand->v_type == V_INT);
+    return BooleanV(rand->v_type == V_INT || rand->v_type == V_REAL);
 }
 
 Value IsNull::evalRator(const Value &rand) { // null?
@@ -636,7 +918,7 @@ Value IsPair::evalRator(const Value &rand) { // pair?
 }
 
 Value IsProcedure::evalRator(const Value &rand) { // procedure?
-    return BooleanV(rand->v_type == V_PROC);
+    return BooleanV(rand->v_type == V_PROC || rand->v_type == V_PRIMITIVE);
 }
 
 Value IsSymbol::evalRator(const Value &rand) { // symbol?
@@ -647,32 +929,61 @@ Value IsString::evalRator(const Value &rand) { // string?
     return BooleanV(rand->v_type == V_STRING);
 }
 
+// Hash-consing of quoted constants. Numbers, booleans and the empty list are
+// shared between all literals since eq? compares them by value anyway. Pairs
+// and strings keep their own identity per literal, as (eq? '(1) '(1)) must be
+// #f; they are only marked immutable, and Quote shares them across
+// evaluations of the same literal.
+static Value internConstant(const Value &v) {
+    static std::map<int, Value> integers;
+    static std::map<std::pair<int, int>, Value> rationals;
+    static Value true_value = BooleanV(true);
+    static Value false_value = BooleanV(false);
+    static Value null_value = NullV();
+    switch (v->v_type) {
+        case V_INT:
+            return integers.insert(std::make_pair(dynamic_cast<Integer*>(v.get())->n, v)).first->second;
+        case V_RATIONAL: {
+            Rational *r = dynamic_cast<Rational*>(v.get());
+            return rationals.insert(std::make_pair(std::make_pair(r->numerator, r->denominator), v)).first->second;
+        }
+        case V_BOOL:
+            return dynamic_cast<Boolean*>(v.get())->b ? true_value : false_value;
+        case V_NULL:
+            return null_value;
+        case V_PAIR:
+            dynamic_cast<Pair*>(v.get())->constant = true;
+            return v;
+        default:
+            return v;
+    }
+}
+
 // Helper function to convert Syntax to Value
 Value syntaxToValue(const Syntax &s) {
     if (dynamic_cast<Number*>(s.get()) != nullptr) {
         Number* num = dynamic_cast<Number*>(s.get());
-        return IntegerV(num->n);
+        return internConstant(IntegerV(num->n));
     } else if (dynamic_cast<RationalSyntax*>(s.get()) != nullptr) {
         RationalSyntax* rat = dynamic_cast<RationalSyntax*>(s.get());
-        return RationalV(rat->numerator, rat->denominator);
+        return internConstant(RationalV(rat->numerator, rat->denominator));
+    } else if (dynamic_cast<RealSyntax*>(s.get()) != nullptr) {
+        return RealV(dynamic_cast<RealSyntax*>(s.get())->x);
     } else if (dynamic_cast<TrueSyntax*>(s.get()) != nullptr) {
-        return BooleanV(true);
+        return internConstant(BooleanV(true));
     } else if (dynamic_cast<FalseSyntax*>(s.get()) != nullptr) {
-        return BooleanV(false);
+        return internConstant(BooleanV(false));
     } else if (dynamic_cast<SymbolSyntax*>(s.get()) != nullptr) {
         SymbolSyntax* sym = dynamic_cast<SymbolSyntax*>(s.get());
         return SymbolV(sym->s);
     } else if (dynamic_cast<StringSyntax*>(s.get()) != nullptr) {
         StringSyntax* str = dynamic_cast<StringSyntax*>(s.get());
-        return StringV(str->s);
+        return internConstant(StringV(str->s));
     } else if (dynamic_cast<List*>(s.get()) != nullptr) {
         List* lst = dynamic_cast<List*>(s.get());
-        if (lst->stxs.empty()) {
-            return NullV();
-        }
-        Value result = NullV();
+        Value result = internConstant(NullV());
         for (int i = lst->stxs.size() - 1; i >= 0; --i) {
-            result = PairV(syntaxToValue(lst->stxs[i]), result);
+            result = internConstant(PairV(syntaxToValue(lst->stxs[i]), result));
         }
         return result;
     }
@@ -680,6 +991,7 @@ Value syntaxToValue(const Syntax &s) {
 }
 
 Value Begin::eval(Assoc &e) {
+    EVAL_STATS_SCOPE();
     if (es.empty()) return VoidV();
     Value result = VoidV();
     for (const auto &expr : es) {
@@ -689,10 +1001,18 @@ Value Begin::eval(Assoc &e) {
 }
 
 Value Quote::eval(Assoc& e) {
-    return syntaxToValue(s);
+    EVAL_STATS_SCOPE();
+    // Quoted data is immutable, so it is converted once and then shared
+    if (!datum) {
+        datum = syntaxToValue(s).ptr;
+    }
+    Value result(nullptr);
+    result.ptr = datum;
+    return result;
 }
 
 Value AndVar::eval(Assoc &e) { // and with short-circuit evaluation
+    EVAL_STATS_SCOPE();
     if (rands.empty()) return BooleanV(true);
     Value result = BooleanV(true);
     for (const auto &expr : rands) {
@@ -705,6 +1025,7 @@ Value AndVar::eval(Assoc &e) { // and with short-circuit evaluation
 }
 
 Value OrVar::eval(Assoc &e) { // or with short-circuit evaluation
+    EVAL_STATS_SCOPE();
     if (rands.empty()) return BooleanV(false);
     for (const auto &expr : rands) {
         Value result = expr->eval(e);
@@ -723,6 +1044,7 @@ Value Not::evalRator(const Value &rand) { // not
 }
 
 Value If::eval(Assoc &e) {
+    EVAL_STATS_SCOPE();
     Value cond_val = cond->eval(e);
     bool is_true = true;
     if (cond_val->v_type == V_BOOL && !dynamic_cast<Boolean*>(cond_val.get())->b) {
@@ -736,6 +1058,7 @@ Value If::eval(Assoc &e) {
 }
 
 Value Cond::eval(Assoc &env) {
+    EVAL_STATS_SCOPE();
     for (const auto &clause : clauses) {
         if (clause.empty()) continue;
 
@@ -770,60 +1093,247 @@ Value Cond::eval(Assoc &env) {
 }
 
 Value Lambda::eval(Assoc &env) {
-    return ProcedureV(x, e, env);
+    EVAL_STATS_SCOPE();
+    if (!closed) {
+        return ProcedureV(code, env);
+    }
+    if (!constant) {
+        constant = ProcedureV(code, empty()).ptr;
+    }
+    Value result(nullptr);
+    result.ptr = constant;
+    return result;
+}
+
+// Calls a first-class primitive with already-evaluated arguments
+static Value applyPrimitive(Primitive *prim, const std::vector<Value> &args) {
+    ExprBase *node = prim->node.get();
+    if (prim->op == E_RECORD_ACCESS && args.size() == 1) {
+        // Field loads skip the operator-kind tests below
+        return static_cast<RecordAccess*>(node)->evalRator(args[0]);
+    }
+    if (Variadic *variadic = dynamic_cast<Variadic*>(node)) {
+        return variadic->evalRator(args);
+    }
+    if (Binary *binary = dynamic_cast<Binary*>(node)) {
+        if (args.size() != 2) throw RuntimeError("Wrong number of arguments");
+        return binary->evalRator(args[0], args[1]);
+    }
+    if (Unary *unary = dynamic_cast<Unary*>(node)) {
+        if (args.size() != 1) throw RuntimeError("Wrong number of arguments");
+        return unary->evalRator(args[0]);
+    }
+    if (prim->op == E_AND) {
+        Value result = BooleanV(true);
+        for (const auto &arg : args) {
+            result = arg;
+            if (result->v_type == V_BOOL && !dynamic_cast<Boolean*>(result.get())->b) {
+                return result;
+            }
+        }
+        return result;
+    }
+    if (prim->op == E_OR) {
+        for (const auto &arg : args) {
+            if (arg->v_type != V_BOOL || dynamic_cast<Boolean*>(arg.get())->b) {
+                return arg;
+            }
+        }
+        return BooleanV(false);
+    }
+    if (!args.empty()) throw RuntimeError("Wrong number of arguments");
+    Assoc no_env = empty();
+    return node->eval(no_env);
+}
+
+/**
+ * @brief Binds the internal defines of a body, unassigned, in front of env
+ *
+ * Each define then stores into its own frame, so procedures defined earlier in
+ * the body see the later ones and the parse-time lexical addresses hold.
+ */
+static Assoc bindLocals(const std::vector<std::string> &locals, Assoc env) {
+    for (const auto &name : locals) {
+        env = extend(name, Value(nullptr), env);
+    }
+    return env;
+}
+
+bool call_instrumentation_enabled = false;
+
+/**
+ * @brief Binds a closure's parameters and internal defines in front of its environment
+ *
+ * Kept out of line so that its temporaries are gone before the body runs and
+ * only the caller's frame stays on the native stack for the call.
+ */
+static __attribute__((noinline)) Assoc bindParameters(const Procedure *clos_ptr, const std::vector<Value> &args) {
+    const CodeObject *code = clos_ptr->code.get();
+    if (args.size() != code->arity) {
+        throw RuntimeError("Wrong number of arguments");
+    }
+    Assoc param_env = clos_ptr->env;
+    for (size_t i = 0; i < code->arity; ++i) {
+        param_env = extend(code->parameters[i], args[i], param_env);
+    }
+    return bindLocals(code->locals, param_env);
+}
+
+/**
+ * @brief Applies a closure under the profiler, tracer and memo table
+ *
+ * The cold half of applyProcedure, taken only when call instrumentation is on
+ * or the closure is memoized, so the probes never widen the common frame.
+ */
+static __attribute__((noinline)) Value applyInstrumented(Procedure *clos_ptr, const std::vector<Value> &args) {
+    const CodeObject *code = clos_ptr->code.get();
+    if (args.size() != code->arity) {
+        throw RuntimeError("Wrong number of arguments");
+    }
+    ProfileScope profile_scope(code->name);
+    SampleFrame sample_frame(code->name.get());
+    TraceScope trace_scope(code->name.get());
+    AllocSiteScope alloc_site(code->name.get());
+    Value cached(nullptr);
+    if (clos_ptr->memo && clos_ptr->memo->lookup(args, cached)) {
+        return cached;
+    }
+    Assoc param_env = bindParameters(clos_ptr, args);
+    if (clos_ptr->memo) {
+        // Hold the table: the body may rebind the only name referring to proc
+        std::shared_ptr<MemoTable> memo = clos_ptr->memo;
+        Value result = code->body->eval(param_env);
+        memo->insert(args, result);
+        return result;
+    }
+    return code->body->eval(param_env);
+}
+
+// Fast internal call path shared by Apply and the native library procedures
+Value applyProcedure(const Value &proc, const std::vector<Value> &args) {
+    consumeFuel();
+    if (proc->v_type == V_PROC) {
+        Procedure *clos_ptr = static_cast<Procedure*>(proc.get());
+        if (call_instrumentation_enabled || clos_ptr->memo) {
+            return applyInstrumented(clos_ptr, args);
+        }
+        Assoc param_env = bindParameters(clos_ptr, args);
+        return clos_ptr->code->body->eval(param_env);
+    }
+    if (proc->v_type == V_PRIMITIVE) {
+        return applyPrimitive(static_cast<Primitive*>(proc.get()), args);
+    }
+    throw RuntimeError("Attempt to apply a non-procedure");
 }
 
 Value Apply::eval(Assoc &e) {
+    EVAL_STATS_SCOPE();
     Value rator_val = rator->eval(e);
-    if (rator_val->v_type != V_PROC) {
+    if (rator_val->v_type != V_PROC && rator_val->v_type != V_PRIMITIVE) {
         throw RuntimeError("Attempt to apply a non-procedure");
     }
 
-    Procedure* clos_ptr = dynamic_cast<Procedure*>(rator_val.get());
-
     std::vector<Value> args;
+    args.reserve(rand.size());
     for (const auto &expr : rand) {
         args.push_back(expr->eval(e));
     }
 
-    // Check for variadic Begin node
-    if (auto begin_node = dynamic_cast<Begin*>(clos_ptr->e.get())) {
-        // Handle multi-expression body
+    // The fast path of applyProcedure, repeated so that a plain closure call
+    // evaluates its body from this frame rather than from one more below it
+    if (rator_val->v_type == V_PROC && !call_instrumentation_enabled) {
+        Procedure *clos_ptr = static_cast<Procedure*>(rator_val.get());
+        if (!clos_ptr->memo) {
+            consumeFuel();
+            Assoc param_env = bindParameters(clos_ptr, args);
+            return clos_ptr->code->body->eval(param_env);
+        }
     }
+    return applyProcedure(rator_val, args);
+}
 
-    if (args.size() != clos_ptr->parameters.size()) {
-        throw RuntimeError("Wrong number of arguments");
+// Library procedures that a define has bound as a variable since startup,
+// indexed by ExprType; calls of the others skip the environment lookup
+static std::vector<bool> library_rebound;
+
+static void noteLibraryRebinding(const std::string &name) {
+    if (library_syntax.count(name)) ++eval_cache_epoch;
+    auto it = library_procedures.find(name);
+    if (it == library_procedures.end()) return;
+    ++eval_cache_epoch;
+    if (library_rebound.size() <= (size_t)it->second) {
+        library_rebound.resize(it->second + 1, false);
     }
+    library_rebound[it->second] = true;
+}
 
-    Assoc param_env = clos_ptr->env;
-    for (size_t i = 0; i < clos_ptr->parameters.size(); ++i) {
-        param_env = extend(clos_ptr->parameters[i], args[i], param_env);
+Value LibraryCall::eval(Assoc &e) {
+    if ((size_t)op < library_rebound.size() && library_rebound[op]) {
+        // The closure may predate the define, so fall back to the global scope
+        Value proc = find(name, e);
+        if (proc.get() == nullptr && interaction_env != nullptr) {
+            proc = find(name, *interaction_env);
+        }
+        if (proc.get() != nullptr) {
+            if (proc->v_type != V_PROC && proc->v_type != V_PRIMITIVE) {
+                throw RuntimeError("Attempt to apply a non-procedure");
+            }
+            std::vector<Value> args;
+            args.reserve(rand.size());
+            for (const auto &expr : rand) {
+                args.push_back(expr->eval(e));
+            }
+            return applyProcedure(proc, args);
+        }
+    }
+    if (native.get() == nullptr) {
+        throw RuntimeError(arity_error);
     }
+    return native->eval(e);
+}
 
-    return clos_ptr->e->eval(param_env);
+/**
+ * @brief Frame that binds var, starting at its parse-time lexical address
+ *
+ * Frames unknown to the parser can only precede the addressed one, so a
+ * name mismatch at depth means the binding moved further out and the full
+ * walk finds it.
+ */
+static AssocList *bindingFrame(const std::string &var, int depth, Assoc &env) {
+    if (depth >= 0) {
+        AssocList *frame = env.get();
+        for (int i = 0; i < depth && frame != nullptr; ++i) {
+            frame = frame->next.get();
+        }
+        if (frame != nullptr && frame->x == var) return frame;
+    }
+    return findBinding(var, env);
 }
 
 Value Define::eval(Assoc &env) {
+    EVAL_STATS_SCOPE();
     // Check if variable name overlaps with primitives or reserved words
     if (primitives.count(var) || reserved_words.count(var)) {
         throw RuntimeError("Cannot redefine primitive or reserved word: " + var);
     }
 
-    Value val = e->eval(env);
-
-    // Try to modify existing binding
-    Value existing = find(var, env);
-    if (existing.get() != nullptr) {
-        modify(var, val, env);
-    } else {
-        // Create new binding by extending environment
-        env = extend(var, val, env);
+    // Bind the name before evaluating the body so that a procedure being
+    // defined can refer to itself, as with letrec
+    AssocList *frame = bindingFrame(var, depth, env);
+    if (frame == nullptr) {
+        noteLibraryRebinding(var);
+        env = extend(var, Value(nullptr), env);
+        frame = env.get();
     }
 
+    Value val = e->eval(env);
+    frame->v = val;
+
     return VoidV();
 }
 
 Value Let::eval(Assoc &env) {
+    EVAL_STATS_SCOPE();
     // Evaluate all binding expressions in current environment
     std::vector<Value> vals;
     for (const auto &binding : bind) {
@@ -835,11 +1345,13 @@ Value Let::eval(Assoc &env) {
     for (size_t i = 0; i < bind.size(); ++i) {
         new_env = extend(bind[i].first, vals[i], new_env);
     }
+    new_env = bindLocals(locals, new_env);
 
     return body->eval(new_env);
 }
 
 Value Letrec::eval(Assoc &env) {
+    EVAL_STATS_SCOPE();
     // Create new environment with placeholder bindings
     Assoc new_env = env;
     for (const auto &binding : bind) {
@@ -851,27 +1363,836 @@ Value Letrec::eval(Assoc &env) {
         Value val = binding.second->eval(new_env);
         modify(binding.first, val, new_env);
     }
+    new_env = bindLocals(locals, new_env);
+
+    return body->eval(new_env);
+}
+
+// Slots of the values register; more values get an object of their own
+const size_t VALUES_REGISTER_SLOTS = 4;
+
+// Result object of values, refilled while nothing else refers to it
+static Value values_register(nullptr);
+
+/**
+ * @brief Empties the values register and returns it for filling
+ *
+ * Values are almost always received right away by call-with-values or
+ * let-values, which drop the object again, so a single object serves every
+ * call without touching the heap. A result that escaped, into a memo table or
+ * a variable, still holds a reference: it keeps the object as it is and the
+ * register starts a new one.
+ */
+static Value claimValuesRegister() {
+    if (values_register.get() == nullptr || values_register.ptr.use_count() != 1) {
+        values_register = MultipleValuesV(std::vector<Value>());
+        static_cast<MultipleValues*>(values_register.get())->values.reserve(VALUES_REGISTER_SLOTS);
+    }
+    static_cast<MultipleValues*>(values_register.get())->values.clear();
+    return values_register;
+}
+
+/**
+ * @brief Appends what a producer returned: each of its values, or the result itself
+ */
+static void receiveValues(const Value &result, std::vector<Value> &out) {
+    if (result->v_type != V_VALUES) {
+        out.push_back(result);
+        return;
+    }
+    std::vector<Value> &values = static_cast<MultipleValues*>(result.get())->values;
+    if (result.get() == values_register.get() && values_register.ptr.use_count() == 2) {
+        // Held by the register and the caller only, so nothing can receive it again
+        std::move(values.begin(), values.end(), std::back_inserter(out));
+        values.clear();
+    } else {
+        out.insert(out.end(), values.begin(), values.end());
+    }
+}
+
+Value LetValues::eval(Assoc &env) {
+    EVAL_STATS_SCOPE();
+    // Evaluate all producers in the current environment
+    std::vector<Value> vals;
+    for (const auto &binding : bind) {
+        size_t before = vals.size();
+        receiveValues(binding.second->eval(env), vals);
+        if (vals.size() - before != binding.first.size()) {
+            throw RuntimeError("let-values: expected " + std::to_string(binding.first.size()) +
+                               " values, got " + std::to_string(vals.size() - before));
+        }
+    }
+
+    Assoc new_env = env;
+    size_t k = 0;
+    for (const auto &binding : bind) {
+        for (const auto &name : binding.first) {
+            new_env = extend(name, vals[k++], new_env);
+        }
+    }
+    new_env = bindLocals(locals, new_env);
 
     return body->eval(new_env);
 }
 
 Value Set::eval(Assoc &env) {
+    EVAL_STATS_SCOPE();
     Value val = e->eval(env);
-    Value existing = find(var, env);
-    if (existing.get() == nullptr) {
+    AssocList *frame = bindingFrame(var, depth, env);
+    if (frame == nullptr || frame->v.get() == nullptr) {
         throw RuntimeError("Undefined variable in set!: " + var);
     }
-    modify(var, val, env);
+    frame->v = val;
     return VoidV();
 }
 
 Value Display::evalRator(const Value &rand) { // display function
     if (rand->v_type == V_STRING) {
-        String* str_ptr = dynamic_cast<String*>(rand.get());
-        std::cout << str_ptr->s;
+        const std::string &text = dynamic_cast<String*>(rand.get())->str();
+        std::cout.write(text.data(), text.size());
     } else {
         rand->show(std::cout);
     }
 
     return VoidV();
 }
+
+
+// Truth test shared by the native library procedures: only #f is false
+static bool isTrue(const Value &v) {
+    return v->v_type != V_BOOL || dynamic_cast<Boolean*>(v.get())->b;
+}
+
+// Advances a set of lists in lockstep, storing their cars in call_args from
+// index offset on. Returns false once any list is exhausted.
+static bool nextElements(std::vector<Value> &lists, std::vector<Value> &call_args,
+                         size_t offset, const char *who) {
+    for (const auto &lst : lists) {
+        if (lst->v_type == V_NULL) return false;
+        if (lst->v_type != V_PAIR) {
+            throw RuntimeError(std::string(who) + ": argument must be a list");
+        }
+    }
+    for (size_t i = 0; i < lists.size(); ++i) {
+        Pair *p = static_cast<Pair*>(lists[i].get());
+        call_args[offset + i] = p->car;
+        lists[i] = p->cdr;
+    }
+    return true;
+}
+
+Value MapFunc::evalRator(const std::vector<Value> &args) { // map
+    if (args.size() < 2) throw RuntimeError("Wrong number of arguments for map");
+    std::vector<Value> lists(args.begin() + 1, args.end());
+    std::vector<Value> call_args(lists.size(), Value(nullptr));
+    Value head = NullV();
+    Pair *tail = nullptr;
+    while (nextElements(lists, call_args, 0, "map")) {
+        Value cell = PairV(applyProcedure(args[0], call_args), NullV());
+        if (tail == nullptr) head = cell;
+        else tail->cdr = cell;
+        tail = static_cast<Pair*>(cell.get());
+    }
+    return head;
+}
+
+Value ForEach::evalRator(const std::vector<Value> &args) { // for-each
+    if (args.size() < 2) throw RuntimeError("Wrong number of arguments for for-each");
+    std::vector<Value> lists(args.begin() + 1, args.end());
+    std::vector<Value> call_args(lists.size(), Value(nullptr));
+    while (nextElements(lists, call_args, 0, "for-each")) {
+        applyProcedure(args[0], call_args);
+    }
+    return VoidV();
+}
+
+Value Filter::evalRator(const Value &pred, const Value &lst) { // filter
+    std::vector<Value> lists(1, lst);
+    std::vector<Value> call_args(1, Value(nullptr));
+    Value head = NullV();
+    Pair *tail = nullptr;
+    while (nextElements(lists, call_args, 0, "filter")) {
+        if (!isTrue(applyProcedure(pred, call_args))) continue;
+        Value cell = PairV(call_args[0], NullV());
+        if (tail == nullptr) head = cell;
+        else tail->cdr = cell;
+        tail = static_cast<Pair*>(cell.get());
+    }
+    return head;
+}
+
+Value FoldLeft::evalRator(const std::vector<Value> &args) { // fold-left
+    if (args.size() < 3) throw RuntimeError("Wrong number of arguments for fold-left");
+    std::vector<Value> lists(args.begin() + 2, args.end());
+    std::vector<Value> call_args(lists.size() + 1, Value(nullptr));
+    Value acc = args[1];
+    while (nextElements(lists, call_args, 1, "fold-left")) {
+        call_args[0] = acc;
+        acc = applyProcedure(args[0], call_args);
+    }
+    return acc;
+}
+
+Value FoldRight::evalRator(const std::vector<Value> &args) { // fold-right
+    if (args.size() < 3) throw RuntimeError("Wrong number of arguments for fold-right");
+    // Buffer the elements so the right-to-left pass needs no recursion
+    std::vector<Value> lists(args.begin() + 2, args.end());
+    size_t width = lists.size();
+    std::vector<Value> row(width + 1, Value(nullptr));
+    std::vector<Value> elements;
+    while (nextElements(lists, row, 0, "fold-right")) {
+        elements.insert(elements.end(), row.begin(), row.begin() + width);
+    }
+    Value acc = args[1];
+    for (size_t end = elements.size(); end > 0; end -= width) {
+        std::copy(elements.begin() + (end - width), elements.begin() + end, row.begin());
+        row[width] = acc;
+        acc = applyProcedure(args[0], row);
+    }
+    return acc;
+}
+
+Value Reduce::evalRator(const std::vector<Value> &args) { // reduce
+    if (args.size() != 3) throw RuntimeError("Wrong number of arguments for reduce");
+    std::vector<Value> lists(1, args[2]);
+    std::vector<Value> call_args(2, Value(nullptr));
+    if (!nextElements(lists, call_args, 1, "reduce")) return args[1];
+    Value acc = call_args[1];
+    while (nextElements(lists, call_args, 0, "reduce")) {
+        call_args[1] = acc;
+        acc = applyProcedure(args[0], call_args);
+    }
+    return acc;
+}
+
+Value ApplyProc::evalRator(const std::vector<Value> &args) { // apply
+    if (args.size() < 2) throw RuntimeError("Wrong number of arguments for apply");
+    std::vector<Value> call_args(args.begin() + 1, args.end() - 1);
+    Value rest = args.back();
+    while (rest->v_type == V_PAIR) {
+        Pair *p = static_cast<Pair*>(rest.get());
+        call_args.push_back(p->car);
+        rest = p->cdr;
+    }
+    if (rest->v_type != V_NULL) {
+        throw RuntimeError("apply: last argument must be a list");
+    }
+    return applyProcedure(args[0], call_args);
+}
+
+// Walks lst to its k-th tail for list-ref and list-tail
+static Value nthTail(const Value &lst, const Value &k, const char *who) {
+    if (k->v_type != V_INT || dynamic_cast<Integer*>(k.get())->n < 0) {
+        throw RuntimeError(std::string(who) + ": index must be a non-negative integer");
+    }
+    Value curr = lst;
+    for (int i = dynamic_cast<Integer*>(k.get())->n; i > 0; --i) {
+        if (curr->v_type != V_PAIR) {
+            throw RuntimeError(std::string(who) + ": index out of range");
+        }
+        curr = static_cast<Pair*>(curr.get())->cdr;
+    }
+    return curr;
+}
+
+Value Length::evalRator(const Value &rand) { // length
+    int n = 0;
+    ValueBase *curr = rand.get();
+    while (curr->v_type == V_PAIR) {
+        ++n;
+        curr = static_cast<Pair*>(curr)->cdr.get();
+    }
+    if (curr->v_type != V_NULL) {
+        throw RuntimeError("length: argument must be a proper list");
+    }
+    return IntegerV(n);
+}
+
+Value Append::evalRator(const std::vector<Value> &args) { // append
+    if (args.empty()) return NullV();
+    // Copy every list but the last, which becomes the shared tail
+    Value head = args.back();
+    Pair *tail = nullptr;
+    for (size_t i = 0; i + 1 < args.size(); ++i) {
+        ValueBase *curr = args[i].get();
+        while (curr->v_type == V_PAIR) {
+            Pair *p = static_cast<Pair*>(curr);
+            Value cell = PairV(p->car, args.back());
+            if (tail == nullptr) head = cell;
+            else tail->cdr = cell;
+            tail = static_cast<Pair*>(cell.get());
+            curr = p->cdr.get();
+        }
+        if (curr->v_type != V_NULL) {
+            throw RuntimeError("append: argument must be a proper list");
+        }
+    }
+    return head;
+}
+
+Value Reverse::evalRator(const Value &rand) { // reverse
+    Value result = NullV();
+    ValueBase *curr = rand.get();
+    while (curr->v_type == V_PAIR) {
+        Pair *p = static_cast<Pair*>(curr);
+        result = PairV(p->car, result);
+        curr = p->cdr.get();
+    }
+    if (curr->v_type != V_NULL) {
+        throw RuntimeError("reverse: argument must be a proper list");
+    }
+    return result;
+}
+
+Value ListRef::evalRator(const Value &lst, const Value &k) { // list-ref
+    Value cell = nthTail(lst, k, "list-ref");
+    if (cell->v_type != V_PAIR) {
+        throw RuntimeError("list-ref: index out of range");
+    }
+    return static_cast<Pair*>(cell.get())->car;
+}
+
+Value ListTail::evalRator(const Value &lst, const Value &k) { // list-tail
+    return nthTail(lst, k, "list-tail");
+}
+
+Value Memq::evalRator(const Value &x, const Value &lst) { // memq
+    Value curr = lst;
+    while (curr->v_type == V_PAIR) {
+        Pair *p = static_cast<Pair*>(curr.get());
+        if (isEqValues(x, p->car)) return curr;
+        curr = p->cdr;
+    }
+    if (curr->v_type != V_NULL) {
+        throw RuntimeError("memq: argument must be a proper list");
+    }
+    return BooleanV(false);
+}
+
+Value Member::evalRator(const Value &x, const Value &lst) { // member
+    Value curr = lst;
+    while (curr->v_type == V_PAIR) {
+        Pair *p = static_cast<Pair*>(curr.get());
+        if (isEqualValues(x, p->car)) return curr;
+        curr = p->cdr;
+    }
+    if (curr->v_type != V_NULL) {
+        throw RuntimeError("member: argument must be a proper list");
+    }
+    return BooleanV(false);
+}
+
+Value Assq::evalRator(const Value &x, const Value &alist) { // assq
+    ValueBase *curr = alist.get();
+    while (curr->v_type == V_PAIR) {
+        Pair *p = static_cast<Pair*>(curr);
+        if (p->car->v_type != V_PAIR) {
+            throw RuntimeError("assq: argument must be an association list");
+        }
+        Pair *entry = static_cast<Pair*>(p->car.get());
+        if (isEqValues(x, entry->car)) return p->car;
+        curr = p->cdr.get();
+    }
+    if (curr->v_type != V_NULL) {
+        throw RuntimeError("assq: argument must be a proper list");
+    }
+    return BooleanV(false);
+}
+
+Value AssocFunc::evalRator(const Value &x, const Value &alist) { // assoc
+    ValueBase *curr = alist.get();
+    while (curr->v_type == V_PAIR) {
+        Pair *p = static_cast<Pair*>(curr);
+        if (p->car->v_type != V_PAIR) {
+            throw RuntimeError("assoc: argument must be an association list");
+        }
+        Pair *entry = static_cast<Pair*>(p->car.get());
+        if (isEqualValues(x, entry->car)) return p->car;
+        curr = p->cdr.get();
+    }
+    if (curr->v_type != V_NULL) {
+        throw RuntimeError("assoc: argument must be a proper list");
+    }
+    return BooleanV(false);
+}
+
+// Stable bottom-up merge sort. An element from the right run is taken only
+// when it is strictly less than the left one, which keeps equal keys in order.
+template <typename Less>
+static void mergeSort(std::vector<Value> &items, Less less) {
+    size_t n = items.size();
+    std::vector<Value> buffer(n, Value(nullptr));
+    for (size_t width = 1; width < n; width *= 2) {
+        for (size_t lo = 0; lo < n; lo += 2 * width) {
+            size_t mid = std::min(lo + width, n);
+            size_t hi = std::min(lo + 2 * width, n);
+            size_t i = lo, j = mid, k = lo;
+            while (i < mid && j < hi) {
+                if (less(items[j], items[i])) buffer[k++] = items[j++];
+                else buffer[k++] = items[i++];
+            }
+            while (i < mid) buffer[k++] = items[i++];
+            while (j < hi) buffer[k++] = items[j++];
+        }
+        items.swap(buffer);
+    }
+}
+
+// Sorts a proper list with a Scheme comparator and rebuilds it in one pass.
+// (< ...) and (> ...) on fixnums are compared natively without any calls.
+static Value sortList(const Value &lst, const Value &less, const char *who) {
+    std::vector<Value> items;
+    bool all_fixnums = true;
+    ValueBase *curr = lst.get();
+    while (curr->v_type == V_PAIR) {
+        Pair *p = static_cast<Pair*>(curr);
+        all_fixnums = all_fixnums && p->car->v_type == V_INT;
+        items.push_back(p->car);
+        curr = p->cdr.get();
+    }
+    if (curr->v_type != V_NULL) {
+        throw RuntimeError(std::string(who) + ": argument must be a proper list");
+    }
+    if (less->v_type != V_PROC && less->v_type != V_PRIMITIVE) {
+        throw RuntimeError(std::string(who) + ": comparator must be a procedure");
+    }
+
+    ExprType op = less->v_type == V_PRIMITIVE ? static_cast<Primitive*>(less.get())->op : E_APPLY;
+    if (all_fixnums && op == E_LT) {
+        mergeSort(items, [](const Value &a, const Value &b) {
+            return static_cast<Integer*>(a.get())->n < static_cast<Integer*>(b.get())->n;
+        });
+    } else if (all_fixnums && op == E_GT) {
+        mergeSort(items, [](const Value &a, const Value &b) {
+            return static_cast<Integer*>(a.get())->n > static_cast<Integer*>(b.get())->n;
+        });
+    } else {
+        std::vector<Value> call_args(2, Value(nullptr));
+        mergeSort(items, [&](const Value &a, const Value &b) {
+            call_args[0] = a;
+            call_args[1] = b;
+            return isTrue(applyProcedure(less, call_args));
+        });
+    }
+
+    Value result = NullV();
+    for (size_t i = items.size(); i > 0; --i) {
+        result = PairV(items[i - 1], result);
+    }
+    return result;
+}
+
+Value Sort::evalRator(const Value &lst, const Value &less) { // sort
+    return sortList(lst, less, "sort");
+}
+
+Value ListSort::evalRator(const Value &less, const Value &lst) { // list-sort
+    return sortList(lst, less, "list-sort");
+}
+
+Value Memoize::evalRator(const std::vector<Value> &args) { // memoize
+    if (args.size() != 1 && args.size() != 2) {
+        throw RuntimeError("Wrong number of arguments for memoize");
+    }
+    if (args[0]->v_type != V_PROC) {
+        throw RuntimeError("memoize: argument must be a compound procedure");
+    }
+    size_t capacity = 0;
+    if (args.size() == 2) {
+        if (args[1]->v_type != V_INT || dynamic_cast<Integer*>(args[1].get())->n <= 0) {
+            throw RuntimeError("memoize: size must be a positive integer");
+        }
+        capacity = dynamic_cast<Integer*>(args[1].get())->n;
+    }
+    Procedure *clos_ptr = dynamic_cast<Procedure*>(args[0].get());
+    Procedure *memoized = new Procedure(clos_ptr->code, clos_ptr->env);
+    memoized->memo = std::make_shared<MemoTable>(capacity);
+    return Value(memoized);
+}
+
+Value MemoStats::evalRator(const Value &rand) { // memoize-stats
+    Procedure *clos_ptr = dynamic_cast<Procedure*>(rand.get());
+    if (clos_ptr == nullptr || !clos_ptr->memo) {
+        throw RuntimeError("memoize-stats: argument must be a memoized procedure");
+    }
+    const MemoTable &memo = *clos_ptr->memo;
+    return PairV(IntegerV((int)memo.hits),
+                 PairV(IntegerV((int)memo.misses),
+                       PairV(IntegerV((int)memo.index.size()), NullV())));
+}
+
+Value IsEqual::evalRator(const Value &rand1, const Value &rand2) { // equal?
+    return BooleanV(isEqualValues(rand1, rand2));
+}
+
+// Returns the buffer of a string argument, raising RuntimeError otherwise
+static const String *stringArg(const Value &v, const char *who) {
+    if (v->v_type != V_STRING) {
+        throw RuntimeError(std::string(who) + ": argument must be a string");
+    }
+    return static_cast<String*>(v.get());
+}
+
+Value StringAppend::evalRator(const std::vector<Value> &args) { // string-append
+    if (args.size() == 1) {
+        return StringV(stringArg(args[0], "string-append")->text);
+    }
+    size_t total = 0;
+    for (const auto &arg : args) {
+        total += stringArg(arg, "string-append")->str().size();
+    }
+    std::string result;
+    result.reserve(total);
+    for (const auto &arg : args) {
+        result += static_cast<String*>(arg.get())->str();
+    }
+    return StringV(stringBuffer(std::move(result)));
+}
+
+Value Substring::evalRator(const std::vector<Value> &args) { // substring
+    if (args.size() != 2 && args.size() != 3) {
+        throw RuntimeError("Wrong number of arguments for substring");
+    }
+    const String *str = stringArg(args[0], "substring");
+    int len = str->str().size();
+    int start, end = len;
+    if (args[1]->v_type != V_INT || (args.size() == 3 && args[2]->v_type != V_INT)) {
+        throw RuntimeError("substring: indices must be integers");
+    }
+    start = dynamic_cast<Integer*>(args[1].get())->n;
+    if (args.size() == 3) end = dynamic_cast<Integer*>(args[2].get())->n;
+    if (start < 0 || end < start || end > len) {
+        throw RuntimeError("substring: index out of range");
+    }
+    if (start == 0 && end == len) {
+        return StringV(str->text);
+    }
+    return StringV(str->str().substr(start, end - start));
+}
+
+Value StringLength::evalRator(const Value &rand) { // string-length
+    return IntegerV(stringArg(rand, "string-length")->str().size());
+}
+
+Value StringToSymbol::evalRator(const Value &rand) { // string->symbol
+    return SymbolV(stringArg(rand, "string->symbol")->str());
+}
+
+Value NumberToString::evalRator(const Value &rand) { // number->string
+    if (rand->v_type == V_INT) {
+        return StringV(std::to_string(dynamic_cast<Integer*>(rand.get())->n));
+    }
+    if (rand->v_type == V_RATIONAL) {
+        Rational *r = dynamic_cast<Rational*>(rand.get());
+        return StringV(std::to_string(r->numerator) + "/" + std::to_string(r->denominator));
+    }
+    if (rand->v_type == V_REAL) {
+        std::ostringstream os;
+        rand->show(os);
+        return StringV(os.str());
+    }
+    throw RuntimeError("number->string: argument must be a number");
+}
+
+Value ExactToInexact::evalRator(const Value &rand) { // exact->inexact
+    if (rand->v_type == V_REAL) return rand;
+    return RealV(toDouble(rand, "exact->inexact: argument must be a number"));
+}
+
+Value InexactToExact::evalRator(const Value &rand) { // inexact->exact
+    if (rand->v_type == V_INT || rand->v_type == V_RATIONAL) return rand;
+    if (rand->v_type != V_REAL) {
+        throw RuntimeError("inexact->exact: argument must be a number");
+    }
+    // Scale by powers of two until integral; a double is a dyadic rational
+    double x = dynamic_cast<Real*>(rand.get())->x;
+    if (std::isnan(x) || std::isinf(x)) {
+        throw RuntimeError("inexact->exact: no exact representation");
+    }
+    long long den = 1;
+    while (x != floor(x) && den <= INT_MAX) {
+        x *= 2;
+        den *= 2;
+    }
+    if (x < INT_MIN || x > INT_MAX || den > INT_MAX) {
+        throw RuntimeError("inexact->exact: no exact representation");
+    }
+    if (den == 1) return IntegerV((int)x);
+    return RationalV((int)x, (int)den);
+}
+
+Value DumpHeap::evalRator(const Value &rand) { // dump-heap
+    const String *path = stringArg(rand, "dump-heap");
+    if (snapshot_root == nullptr) {
+        throw RuntimeError("dump-heap: no global environment");
+    }
+    std::ofstream out(path->str());
+    if (!out) {
+        throw RuntimeError("dump-heap: cannot open " + path->str());
+    }
+    writeHeapSnapshot(out, *snapshot_root);
+    return VoidV();
+}
+
+Value HeapLiveBytes::eval(Assoc &e) { // (heap-live-bytes)
+    EVAL_STATS_SCOPE();
+    // Inexact, like current-time-ns: an int would overflow past 2 GiB
+    return RealV(static_cast<double>(heap_stats.live_bytes));
+}
+
+Value HeapAllocations::eval(Assoc &e) { // (heap-allocations)
+    EVAL_STATS_SCOPE();
+    return RealV(static_cast<double>(heap_stats.allocations));
+}
+
+// Origin of current-time-ns
+static const std::chrono::steady_clock::time_point process_start = std::chrono::steady_clock::now();
+
+Value Time::eval(Assoc &e) { // (time body ...)
+    EVAL_STATS_SCOPE();
+    unsigned long long allocations = heap_stats.allocations;
+    unsigned long long bytes = heap_stats.allocated_bytes;
+    long long fuel = eval_fuel.load(std::memory_order_relaxed);
+    std::clock_t cpu_start = std::clock();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    Value result = body->eval(e);
+    double real_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    double cpu_ms = 1000.0 * (std::clock() - cpu_start) / CLOCKS_PER_SEC;
+    char report[160];
+    std::snprintf(report, sizeof(report),
+                  "time: %.3f ms real, %.3f ms cpu, %llu allocations, %llu bytes, %lld steps\n",
+                  real_ms, cpu_ms, heap_stats.allocations - allocations,
+                  heap_stats.allocated_bytes - bytes,
+                  fuel - eval_fuel.load(std::memory_order_relaxed));
+    std::cout << report;
+    return result;
+}
+
+Value CurrentTimeNs::eval(Assoc &e) { // (current-time-ns)
+    EVAL_STATS_SCOPE();
+    // Inexact: an int would overflow within seconds, a double is exact for 104 days
+    return RealV(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - process_start).count());
+}
+
+Value DefineRecordType::eval(Assoc &env) {
+    EVAL_STATS_SCOPE();
+    std::vector<std::pair<std::string, Value>> bindings;
+    std::shared_ptr<RecordType> type = std::make_shared<RecordType>();
+    type->name = type_name;
+    type->fields = fields;
+    bindings.push_back(std::make_pair(constructor,
+        PrimitiveV(E_RECORD_CONSTRUCT, Expr(new RecordConstruct(type, constructor_slots)))));
+    bindings.push_back(std::make_pair(predicate,
+        PrimitiveV(E_RECORD_PREDICATE, Expr(new RecordPredicate(type)))));
+    for (const auto &accessor : accessors) {
+        bindings.push_back(std::make_pair(accessor.first,
+            PrimitiveV(E_RECORD_ACCESS, Expr(new RecordAccess(type, accessor.second, accessor.first)))));
+    }
+    for (const auto &modifier : modifiers) {
+        bindings.push_back(std::make_pair(modifier.first,
+            PrimitiveV(E_RECORD_MODIFY, Expr(new RecordModify(type, modifier.second, modifier.first)))));
+    }
+    for (const auto &binding : bindings) {
+        if (primitives.count(binding.first) || reserved_words.count(binding.first)) {
+            throw RuntimeError("Cannot redefine primitive or reserved word: " + binding.first);
+        }
+    }
+    for (const auto &binding : bindings) {
+        AssocList *frame = findBinding(binding.first, env);
+        if (frame == nullptr) {
+            noteLibraryRebinding(binding.first);
+            env = extend(binding.first, binding.second, env);
+        } else {
+            frame->v = binding.second;
+        }
+    }
+    return VoidV();
+}
+
+Value RecordConstruct::evalRator(const std::vector<Value> &args) {
+    if (args.size() != slots.size()) {
+        throw RuntimeError("Wrong number of arguments");
+    }
+    Value record = RecordV(type);
+    Value *slot = static_cast<Record*>(record.get())->slots();
+    if (slots.size() != type->fields.size()) {
+        // Fields the constructor does not take start out unspecified
+        Value unspecified = VoidV();
+        for (size_t i = 0; i < type->fields.size(); ++i) {
+            slot[i] = unspecified;
+        }
+    }
+    for (size_t i = 0; i < args.size(); ++i) {
+        slot[slots[i]] = args[i];
+    }
+    return record;
+}
+
+Value RecordPredicate::evalRator(const Value &rand) {
+    return BooleanV(rand->v_type == V_RECORD && static_cast<Record*>(rand.get())->type == type);
+}
+
+Value RecordAccess::evalRator(const Value &rand) {
+    if (rand->v_type != V_RECORD || static_cast<Record*>(rand.get())->type != type) {
+        throw RuntimeError(name + ": argument must be a " + type->name);
+    }
+    return static_cast<Record*>(rand.get())->slots()[slot];
+}
+
+Value RecordModify::evalRator(const Value &rand1, const Value &rand2) {
+    if (rand1->v_type != V_RECORD || static_cast<Record*>(rand1.get())->type != type) {
+        throw RuntimeError(name + ": first argument must be a " + type->name);
+    }
+    static_cast<Record*>(rand1.get())->slots()[slot] = rand2;
+    return VoidV();
+}
+
+Value Values::eval(Assoc &e) { // (values x ...) evaluated into the register
+    EVAL_STATS_SCOPE();
+    if (rands.size() == 1) {
+        return rands[0]->eval(e);
+    }
+    if (rands.size() > VALUES_REGISTER_SLOTS) {
+        return Variadic::eval(e);
+    }
+    // Holding the claim makes a values call inside an operand start a new object
+    Value result = claimValuesRegister();
+    std::vector<Value> &values = static_cast<MultipleValues*>(result.get())->values;
+    for (const auto &expr : rands) {
+        values.push_back(expr->eval(e));
+    }
+    return result;
+}
+
+Value Values::evalRator(const std::vector<Value> &args) { // values
+    if (args.size() == 1) {
+        return args[0];
+    }
+    if (args.size() > VALUES_REGISTER_SLOTS) {
+        return MultipleValuesV(args);
+    }
+    Value result = claimValuesRegister();
+    static_cast<MultipleValues*>(result.get())->values.assign(args.begin(), args.end());
+    return result;
+}
+
+Value CallWithValues::evalRator(const Value &producer, const Value &consumer) { // call-with-values
+    std::vector<Value> args;
+    args.reserve(VALUES_REGISTER_SLOTS);
+    receiveValues(applyProcedure(producer, std::vector<Value>()), args);
+    return applyProcedure(consumer, args);
+}
+
+// Inverse of syntaxToValue: rebuilds the syntax a datum was read from
+static Syntax valueToSyntax(const Value &v) {
+    switch (v->v_type) {
+        case V_INT: return Syntax(new Number(static_cast<Integer*>(v.get())->n));
+        case V_RATIONAL: {
+            Rational *rat = static_cast<Rational*>(v.get());
+            return Syntax(new RationalSyntax(rat->numerator, rat->denominator));
+        }
+        case V_REAL: return Syntax(new RealSyntax(static_cast<Real*>(v.get())->x));
+        case V_BOOL:
+            if (static_cast<Boolean*>(v.get())->b) return Syntax(new TrueSyntax());
+            return Syntax(new FalseSyntax());
+        case V_SYM: return Syntax(new SymbolSyntax(static_cast<Symbol*>(v.get())->s));
+        case V_STRING: return Syntax(new StringSyntax(static_cast<String*>(v.get())->str()));
+        case V_NULL: return Syntax(new List());
+        case V_PAIR: {
+            List *list = new List();
+            Syntax result(list);
+            Value rest = v;
+            while (rest->v_type == V_PAIR) {
+                Pair *p = static_cast<Pair*>(rest.get());
+                list->stxs.push_back(valueToSyntax(p->car));
+                rest = p->cdr;
+            }
+            if (rest->v_type != V_NULL) {
+                throw RuntimeError("eval: improper list in expression");
+            }
+            return result;
+        }
+        default:
+            throw RuntimeError(std::string("eval: a ") + heapCategoryName(v->v_type) + " is not an expression");
+    }
+}
+
+/**
+ * @brief Parsed form of a datum passed to eval
+ *
+ * The weak reference proves the key still names the datum the entry was
+ * made for: while it is alive its address cannot be reused.
+ */
+struct EvalCacheEntry {
+    std::weak_ptr<ValueBase> datum;
+    Expr expr;
+    unsigned long long epoch;
+};
+
+static std::unordered_map<const ValueBase*, EvalCacheEntry> eval_cache;
+static size_t eval_cache_sweep_at = 1024;
+
+// Parses datum in env, reusing the previous parse of the same datum object
+static Expr compileDatum(const Value &datum, Assoc &env) {
+    auto it = eval_cache.find(datum.get());
+    if (it != eval_cache.end() && it->second.epoch == eval_cache_epoch &&
+        it->second.datum.lock() == datum.ptr) {
+        return it->second.expr;
+    }
+    Expr expr = valueToSyntax(datum).parse(env);
+    if (eval_cache.size() >= eval_cache_sweep_at) {
+        // Drop entries whose datum is gone or stale before growing further
+        for (auto entry = eval_cache.begin(); entry != eval_cache.end();) {
+            if (entry->second.datum.expired() || entry->second.epoch != eval_cache_epoch) {
+                entry = eval_cache.erase(entry);
+            } else {
+                ++entry;
+            }
+        }
+        eval_cache_sweep_at = std::max<size_t>(1024, 2 * eval_cache.size());
+    }
+    EvalCacheEntry entry = {datum.ptr, expr, eval_cache_epoch};
+    auto inserted = eval_cache.insert(std::make_pair(datum.get(), entry));
+    if (!inserted.second) {
+        inserted.first->second = entry;
+    }
+    return expr;
+}
+
+/**
+ * @brief Returns the evaluator to its startup state when the REPL ends
+ *
+ * Drops every cached parse: cached expressions hold quoted data, which must
+ * be freed while the thread's pending-release list still exists, not during
+ * static teardown. Also forgets which library procedures the session
+ * rebound, so the next case of a --run-tests run starts as a fresh process.
+ */
+void resetEvaluator() {
+    eval_cache.clear();
+    eval_cache_sweep_at = 1024;
+    library_rebound.clear();
+    values_register = Value(nullptr);
+}
+
+Value Eval::evalRator(const std::vector<Value> &args) { // eval
+    Assoc *env = interaction_env;
+    if (args.size() == 2) {
+        if (args[1]->v_type != V_ENVIRONMENT) {
+            throw RuntimeError("eval: second argument must be an environment");
+        }
+        env = static_cast<Environment*>(args[1].get())->env;
+    }
+    if (env == nullptr) {
+        throw RuntimeError("eval: no interaction environment");
+    }
+    Expr expr = compileDatum(args[0], *env);
+    return expr->eval(*env);
+}
+
+Value InteractionEnv::eval(Assoc &e) { // (interaction-environment)
+    EVAL_STATS_SCOPE();
+    if (interaction_env == nullptr) {
+        throw RuntimeError("interaction-environment: no REPL is running");
+    }
+    return EnvironmentV(interaction_env);
+}
@@ -17,7 +17,9 @@ int gcd(int a, int b) {
     return a;
 }
 
-ExprBase::ExprBase(ExprType et) : e_type(et) {}
+int parse_line = 0;
+
+ExprBase::ExprBase(ExprType et) : e_type(et), line(parse_line) {}
 
 Expr::Expr(ExprBase * eb) : ptr(eb) {}
 ExprBase* Expr::operator->() const { return ptr.get(); }
@@ -41,7 +43,9 @@ RationalNum::RationalNum(int num, int den) : ExprBase(E_RATIONAL), numerator(num
     }
 }
 
-StringExpr::StringExpr(const std::string &str) : ExprBase(E_STRING), s(str) {}
+RealNum::RealNum(double x) : ExprBase(E_REAL), x(x) {}
+
+StringExpr::StringExpr(const std::string &str) : ExprBase(E_STRING), text(std::make_shared<const std::string>(str)) {}
 
 True::True() : ExprBase(E_TRUE) {}
 
@@ -163,9 +167,16 @@ Var::Var(const string &s) : ExprBase(E_VAR), x(s) {}
 
 Apply::Apply(const Expr &expr, const vector<Expr> &vec) : ExprBase(E_APPLY), rator(expr), rand(vec) {}
 
-Lambda::Lambda(const vector<string> &vec, const Expr &expr) : ExprBase(E_LAMBDA), x(vec), e(expr) {}
+LibraryCall::LibraryCall(const string &s, ExprType t, const Expr &node, const vector<Expr> &vec, const string &error)
+    : ExprBase(E_LIBRARY_CALL), name(s), op(t), native(node), rand(vec), arity_error(error) {}
+
+CodeObject::CodeObject(const vector<string> &vec, const Expr &expr)
+    : parameters(vec), body(expr), arity(vec.size()), name(std::make_shared<const string>("lambda")) {}
+
+Lambda::Lambda(const vector<string> &vec, const Expr &expr)
+    : ExprBase(E_LAMBDA), code(std::make_shared<CodeObject>(vec, expr)), closed(false) {}
 
-Define::Define(const string &variable, const Expr &expr) : ExprBase(E_DEFINE), var(variable), e(expr) {}
+Define::Define(const string &variable, const Expr &expr, int d) : ExprBase(E_DEFINE), var(variable), e(expr), depth(d) {}
 
 //BINDING CONSTRUCTS
 
@@ -173,10 +184,129 @@ Let::Let(const vector<pair<string, Expr>> &vec, const Expr &e) : ExprBase(E_LET)
 
 Letrec::Letrec(const vector<pair<string, Expr>> &vec, const Expr &expr) : ExprBase(E_LETREC), bind(vec), body(expr) {}
 
+LetValues::LetValues(const vector<pair<vector<string>, Expr>> &vec, const Expr &expr)
+    : ExprBase(E_LET_VALUES), bind(vec), body(expr) {}
+
 //ASSIGNMENT
 
-Set::Set(const std::string &var, const Expr &e) : ExprBase(E_SET), var(var), e(e) {}
+Set::Set(const std::string &var, const Expr &e, int d) : ExprBase(E_SET), var(var), e(e), depth(d) {}
 
 //I/O OPERATIONS
 
-Display::Display(const Expr &r) : Unary(E_DISPLAY, r) {}
\ No newline at end of file
+Display::Display(const Expr &r) : Unary(E_DISPLAY, r) {}
+
+//HIGHER-ORDER LIST OPERATIONS
+
+MapFunc::MapFunc(const std::vector<Expr> &rands) : Variadic(E_MAP, rands) {}
+
+ForEach::ForEach(const std::vector<Expr> &rands) : Variadic(E_FOREACH, rands) {}
+
+Filter::Filter(const Expr &r1, const Expr &r2) : Binary(E_FILTER, r1, r2) {}
+
+FoldLeft::FoldLeft(const std::vector<Expr> &rands) : Variadic(E_FOLDL, rands) {}
+
+FoldRight::FoldRight(const std::vector<Expr> &rands) : Variadic(E_FOLDR, rands) {}
+
+Reduce::Reduce(const std::vector<Expr> &rands) : Variadic(E_REDUCE, rands) {}
+
+ApplyProc::ApplyProc(const std::vector<Expr> &rands) : Variadic(E_APPLYPROC, rands) {}
+
+//LIST LIBRARY OPERATIONS
+
+Length::Length(const Expr &r1) : Unary(E_LENGTH, r1) {}
+
+Append::Append(const std::vector<Expr> &rands) : Variadic(E_APPEND, rands) {}
+
+Reverse::Reverse(const Expr &r1) : Unary(E_REVERSE, r1) {}
+
+ListRef::ListRef(const Expr &r1, const Expr &r2) : Binary(E_LISTREF, r1, r2) {}
+
+ListTail::ListTail(const Expr &r1, const Expr &r2) : Binary(E_LISTTAIL, r1, r2) {}
+
+Memq::Memq(const Expr &r1, const Expr &r2) : Binary(E_MEMQ, r1, r2) {}
+
+Member::Member(const Expr &r1, const Expr &r2) : Binary(E_MEMBER, r1, r2) {}
+
+Assq::Assq(const Expr &r1, const Expr &r2) : Binary(E_ASSQ, r1, r2) {}
+
+AssocFunc::AssocFunc(const Expr &r1, const Expr &r2) : Binary(E_ASSOC, r1, r2) {}
+
+Sort::Sort(const Expr &r1, const Expr &r2) : Binary(E_SORT, r1, r2) {}
+
+ListSort::ListSort(const Expr &r1, const Expr &r2) : Binary(E_LISTSORT, r1, r2) {}
+
+//MEMOIZATION
+
+Memoize::Memoize(const std::vector<Expr> &rands) : Variadic(E_MEMOIZE, rands) {}
+
+MemoStats::MemoStats(const Expr &r1) : Unary(E_MEMOSTATS, r1) {}
+
+//STRUCTURAL EQUALITY
+
+IsEqual::IsEqual(const Expr &r1, const Expr &r2) : Binary(E_EQUALQ, r1, r2) {}
+
+//STRING OPERATIONS
+
+StringAppend::StringAppend(const std::vector<Expr> &rands) : Variadic(E_STRING_APPEND, rands) {}
+
+Substring::Substring(const std::vector<Expr> &rands) : Variadic(E_SUBSTRING, rands) {}
+
+StringLength::StringLength(const Expr &r1) : Unary(E_STRING_LENGTH, r1) {}
+
+StringToSymbol::StringToSymbol(const Expr &r1) : Unary(E_STRING_TO_SYMBOL, r1) {}
+
+NumberToString::NumberToString(const Expr &r1) : Unary(E_NUMBER_TO_STRING, r1) {}
+
+//EXACTNESS CONVERSIONS
+
+ExactToInexact::ExactToInexact(const Expr &r1) : Unary(E_EXACT_TO_INEXACT, r1) {}
+
+InexactToExact::InexactToExact(const Expr &r1) : Unary(E_INEXACT_TO_EXACT, r1) {}
+
+//HEAP INSPECTION
+
+DumpHeap::DumpHeap(const Expr &r1) : Unary(E_DUMP_HEAP, r1) {}
+
+HeapLiveBytes::HeapLiveBytes() : ExprBase(E_HEAP_LIVE_BYTES) {}
+
+HeapAllocations::HeapAllocations() : ExprBase(E_HEAP_ALLOCATIONS) {}
+
+//TIMING
+
+Time::Time(const Expr &expr) : ExprBase(E_TIME), body(expr) {}
+
+CurrentTimeNs::CurrentTimeNs() : ExprBase(E_CURRENT_TIME_NS) {}
+
+//RECORD TYPES
+
+DefineRecordType::DefineRecordType(const string &type_name, const vector<string> &fields,
+                                   const string &constructor, const vector<size_t> &constructor_slots,
+                                   const string &predicate,
+                                   const vector<pair<string, size_t>> &accessors,
+                                   const vector<pair<string, size_t>> &modifiers)
+    : ExprBase(E_DEFINE_RECORD), type_name(type_name), fields(fields), constructor(constructor),
+      constructor_slots(constructor_slots), predicate(predicate), accessors(accessors), modifiers(modifiers) {}
+
+RecordConstruct::RecordConstruct(const std::shared_ptr<const RecordType> &type, const vector<size_t> &slots)
+    : Variadic(E_RECORD_CONSTRUCT, {}), type(type), slots(slots) {}
+
+RecordPredicate::RecordPredicate(const std::shared_ptr<const RecordType> &type)
+    : Unary(E_RECORD_PREDICATE, Expr(nullptr)), type(type) {}
+
+RecordAccess::RecordAccess(const std::shared_ptr<const RecordType> &type, size_t slot, const string &name)
+    : Unary(E_RECORD_ACCESS, Expr(nullptr)), type(type), slot(slot), name(name) {}
+
+RecordModify::RecordModify(const std::shared_ptr<const RecordType> &type, size_t slot, const string &name)
+    : Binary(E_RECORD_MODIFY, Expr(nullptr), Expr(nullptr)), type(type), slot(slot), name(name) {}
+
+//MULTIPLE VALUES
+
+Values::Values(const vector<Expr> &args) : Variadic(E_VALUES, args) {}
+
+CallWithValues::CallWithValues(const Expr &r1, const Expr &r2) : Binary(E_CALL_WITH_VALUES, r1, r2) {}
+
+//EVALUATION OF DATA
+
+Eval::Eval(const vector<Expr> &args) : Variadic(E_EVAL, args) {}
+
+InteractionEnv::InteractionEnv() : ExprBase(E_INTERACTION_ENV) {}
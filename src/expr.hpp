@@ -23,8 +23,11 @@ public:
 #include <cstring>
 #include <vector>
 
+extern int parse_line;   ///< Source line of the form being parsed, 0 outside any
+
 struct ExprBase{
     ExprType e_type;
+    int line;       ///< Source line of the form the node was parsed from, 0 if unknown
     ExprBase(ExprType);
     virtual Value eval(Assoc &) = 0;
     virtual ~ExprBase() = default;
@@ -64,12 +67,22 @@ struct RationalNum : ExprBase {
   virtual Value eval(Assoc &) override;
 };
 
+/**
+ * @brief Decimal literal expression
+ * Represents inexact real numbers
+ */
+struct RealNum : ExprBase {
+  double x;
+  RealNum(double);
+  virtual Value eval(Assoc &) override;
+};
+
 /**
  * @brief String literal expression
  * Represents string values
  */
 struct StringExpr : ExprBase {
-  std::string s;
+  std::shared_ptr<const std::string> text;  ///< Literal buffer shared by every evaluation
   StringExpr(const std::string &);
   virtual Value eval(Assoc &) override;
 };
@@ -350,6 +363,7 @@ struct Begin : ExprBase {
 
 struct Quote : ExprBase {
   Syntax s;
+  std::shared_ptr<ValueBase> datum;  ///< Converted literal, filled on first evaluation
   Quote(const Syntax &);
   virtual Value eval(Assoc &) override;
 };
@@ -389,9 +403,43 @@ struct Apply : ExprBase {
     virtual Value eval(Assoc &) override;
 };
 
+/**
+ * @brief Call of a native library procedure by its name
+ *
+ * The parser picks the native node when nothing in scope binds the name, but
+ * a later top-level define may rebind it before the call runs; the call then
+ * applies that global binding instead. native is null when the arguments do not fit
+ * the native arity, which is an error only if the name is still unbound.
+ */
+struct LibraryCall : ExprBase {
+    std::string name;
+    ExprType op;                ///< Native procedure the name stands for
+    Expr native;
+    std::vector<Expr> rand;
+    std::string arity_error;    ///< Raised when native is null
+    LibraryCall(const std::string &, ExprType, const Expr &, const std::vector<Expr> &, const std::string &);
+    virtual Value eval(Assoc &) override;
+};
+
+/**
+ * @brief Parse-time part of a lambda, shared by every closure made from it
+ *
+ * The parameter order is also the frame layout: a call binds the arguments
+ * in this order in front of the closure's environment.
+ */
+struct CodeObject {
+    std::vector<std::string> parameters;
+    std::vector<std::string> locals;   ///< Internal defines of the body, bound with the parameters
+    Expr body;
+    size_t arity;
+    std::shared_ptr<const std::string> name;  ///< Define-name or source position, for profiling
+    CodeObject(const std::vector<std::string> &, const Expr &);
+};
+
 struct Lambda : ExprBase {
-    std::vector<std::string> x;
-    Expr e;
+    std::shared_ptr<CodeObject> code;
+    bool closed;                          ///< No free variables, so the environment is never consulted
+    std::shared_ptr<ValueBase> constant;  ///< Closure shared by all evaluations when closed
     Lambda(const std::vector<std::string> &, const Expr &);
     virtual Value eval(Assoc &) override;
 };
@@ -399,7 +447,8 @@ struct Lambda : ExprBase {
 struct Define : ExprBase {
     std::string var;
     Expr e;
-    Define(const std::string &, const Expr &);
+    int depth;          ///< Parse-time frame index of an internal define, or -1
+    Define(const std::string &, const Expr &, int);
     virtual Value eval(Assoc &) override;
 };
 
@@ -409,6 +458,7 @@ struct Define : ExprBase {
 
 struct Let : ExprBase {
     std::vector<std::pair<std::string, Expr>> bind;
+    std::vector<std::string> locals;   ///< Internal defines of the body, bound after the variables
     Expr body;
     Let(const std::vector<std::pair<std::string, Expr>> &, const Expr &);
     virtual Value eval(Assoc &) override;
@@ -416,11 +466,20 @@ struct Let : ExprBase {
 
 struct Letrec : ExprBase {
     std::vector<std::pair<std::string, Expr>> bind;
+    std::vector<std::string> locals;   ///< Internal defines of the body, bound after the variables
     Expr body;
     Letrec(const std::vector<std::pair<std::string, Expr>> &, const Expr &);
     virtual Value eval(Assoc &) override;
 };
 
+struct LetValues : ExprBase {
+    std::vector<std::pair<std::vector<std::string>, Expr>> bind;
+    std::vector<std::string> locals;   ///< Internal defines of the body, bound after the variables
+    Expr body;
+    LetValues(const std::vector<std::pair<std::vector<std::string>, Expr>> &, const Expr &);
+    virtual Value eval(Assoc &) override;
+};
+
 // ================================================================================
 //                             ASSIGNMENT
 // ================================================================================
@@ -428,7 +487,8 @@ struct Letrec : ExprBase {
 struct Set : ExprBase {
     std::string var;
     Expr e;
-    Set(const std::string &, const Expr &);
+    int depth;          ///< Parse-time frame index of a local target, or -1
+    Set(const std::string &, const Expr &, int);
     virtual Value eval(Assoc &) override;
 };
 
@@ -441,4 +501,314 @@ struct Display : Unary {
     virtual Value evalRator(const Value &) override;
 };
 
+// ================================================================================
+//                             HIGHER-ORDER LIST OPERATIONS
+// ================================================================================
+
+struct MapFunc : Variadic {
+    MapFunc(const std::vector<Expr> &);
+    virtual Value evalRator(const std::vector<Value> &) override;
+};
+
+struct ForEach : Variadic {
+    ForEach(const std::vector<Expr> &);
+    virtual Value evalRator(const std::vector<Value> &) override;
+};
+
+struct Filter : Binary {
+    Filter(const Expr &, const Expr &);
+    virtual Value evalRator(const Value &, const Value &) override;
+};
+
+struct FoldLeft : Variadic {
+    FoldLeft(const std::vector<Expr> &);
+    virtual Value evalRator(const std::vector<Value> &) override;
+};
+
+struct FoldRight : Variadic {
+    FoldRight(const std::vector<Expr> &);
+    virtual Value evalRator(const std::vector<Value> &) override;
+};
+
+struct Reduce : Variadic {
+    Reduce(const std::vector<Expr> &);
+    virtual Value evalRator(const std::vector<Value> &) override;
+};
+
+struct ApplyProc : Variadic {
+    ApplyProc(const std::vector<Expr> &);
+    virtual Value evalRator(const std::vector<Value> &) override;
+};
+
+// ================================================================================
+//                             LIST LIBRARY OPERATIONS
+// ================================================================================
+
+struct Length : Unary {
+    Length(const Expr &);
+    virtual Value evalRator(const Value &) override;
+};
+
+struct Append : Variadic {
+    Append(const std::vector<Expr> &);
+    virtual Value evalRator(const std::vector<Value> &) override;
+};
+
+struct Reverse : Unary {
+    Reverse(const Expr &);
+    virtual Value evalRator(const Value &) override;
+};
+
+struct ListRef : Binary {
+    ListRef(const Expr &, const Expr &);
+    virtual Value evalRator(const Value &, const Value &) override;
+};
+
+struct ListTail : Binary {
+    ListTail(const Expr &, const Expr &);
+    virtual Value evalRator(const Value &, const Value &) override;
+};
+
+struct Memq : Binary {
+    Memq(const Expr &, const Expr &);
+    virtual Value evalRator(const Value &, const Value &) override;
+};
+
+struct Member : Binary {
+    Member(const Expr &, const Expr &);
+    virtual Value evalRator(const Value &, const Value &) override;
+};
+
+struct Assq : Binary {
+    Assq(const Expr &, const Expr &);
+    virtual Value evalRator(const Value &, const Value &) override;
+};
+
+struct AssocFunc : Binary {
+    AssocFunc(const Expr &, const Expr &);
+    virtual Value evalRator(const Value &, const Value &) override;
+};
+
+struct Sort : Binary {
+    Sort(const Expr &, const Expr &);
+    virtual Value evalRator(const Value &, const Value &) override;
+};
+
+struct ListSort : Binary {
+    ListSort(const Expr &, const Expr &);
+    virtual Value evalRator(const Value &, const Value &) override;
+};
+
+// ================================================================================
+//                             MEMOIZATION
+// ================================================================================
+
+struct Memoize : Variadic {
+    Memoize(const std::vector<Expr> &);
+    virtual Value evalRator(const std::vector<Value> &) override;
+};
+
+struct MemoStats : Unary {
+    MemoStats(const Expr &);
+    virtual Value evalRator(const Value &) override;
+};
+
+// ================================================================================
+//                             STRUCTURAL EQUALITY
+// ================================================================================
+
+struct IsEqual : Binary {
+    IsEqual(const Expr &, const Expr &);
+    virtual Value evalRator(const Value &, const Value &) override;
+};
+
+// ================================================================================
+//                             STRING OPERATIONS
+// ================================================================================
+
+struct StringAppend : Variadic {
+    StringAppend(const std::vector<Expr> &);
+    virtual Value evalRator(const std::vector<Value> &) override;
+};
+
+struct Substring : Variadic {
+    Substring(const std::vector<Expr> &);
+    virtual Value evalRator(const std::vector<Value> &) override;
+};
+
+struct StringLength : Unary {
+    StringLength(const Expr &);
+    virtual Value evalRator(const Value &) override;
+};
+
+struct StringToSymbol : Unary {
+    StringToSymbol(const Expr &);
+    virtual Value evalRator(const Value &) override;
+};
+
+struct NumberToString : Unary {
+    NumberToString(const Expr &);
+    virtual Value evalRator(const Value &) override;
+};
+
+// ================================================================================
+//                             EXACTNESS CONVERSIONS
+// ================================================================================
+
+struct ExactToInexact : Unary {
+    ExactToInexact(const Expr &);
+    virtual Value evalRator(const Value &) override;
+};
+
+struct InexactToExact : Unary {
+    InexactToExact(const Expr &);
+    virtual Value evalRator(const Value &) override;
+};
+
+// ============================================================================
+// Heap inspection
+// ============================================================================
+
+struct DumpHeap : Unary {
+    DumpHeap(const Expr &);
+    virtual Value evalRator(const Value &) override;
+};
+
+/**
+ * @brief (heap-live-bytes): bytes currently counted against --max-heap
+ */
+struct HeapLiveBytes : ExprBase {
+    HeapLiveBytes();
+    virtual Value eval(Assoc &) override;
+};
+
+/**
+ * @brief (heap-allocations): values and environment frames allocated since startup
+ */
+struct HeapAllocations : ExprBase {
+    HeapAllocations();
+    virtual Value eval(Assoc &) override;
+};
+
+// ============================================================================
+// Timing
+// ============================================================================
+
+/**
+ * @brief (time body ...): evaluates the body once and prints its cost
+ *
+ * Steps are units of the --max-steps budget: one per application of a
+ * closure or first-class primitive, callbacks of the native library included.
+ */
+struct Time : ExprBase {
+    Expr body;
+    Time(const Expr &);
+    virtual Value eval(Assoc &) override;
+};
+
+struct CurrentTimeNs : ExprBase {
+    CurrentTimeNs();
+    virtual Value eval(Assoc &) override;
+};
+
+// ============================================================================
+// Record types
+// ============================================================================
+
+struct RecordType;
+
+/**
+ * @brief (define-record-type <name> (ctor field ...) pred (field accessor [modifier]) ...)
+ *
+ * Every evaluation creates a new type and binds its procedures. They are
+ * first-class primitives whose nodes below hold the type and a slot index.
+ */
+struct DefineRecordType : ExprBase {
+    std::string type_name;
+    std::vector<std::string> fields;
+    std::string constructor;
+    std::vector<size_t> constructor_slots;                ///< Slot filled by each constructor argument
+    std::string predicate;
+    std::vector<std::pair<std::string, size_t>> accessors;
+    std::vector<std::pair<std::string, size_t>> modifiers;
+    DefineRecordType(const std::string &, const std::vector<std::string> &,
+                     const std::string &, const std::vector<size_t> &, const std::string &,
+                     const std::vector<std::pair<std::string, size_t>> &,
+                     const std::vector<std::pair<std::string, size_t>> &);
+    virtual Value eval(Assoc &) override;
+};
+
+struct RecordConstruct : Variadic {
+    std::shared_ptr<const RecordType> type;
+    std::vector<size_t> slots;
+    RecordConstruct(const std::shared_ptr<const RecordType> &, const std::vector<size_t> &);
+    virtual Value evalRator(const std::vector<Value> &) override;
+};
+
+struct RecordPredicate : Unary {
+    std::shared_ptr<const RecordType> type;
+    RecordPredicate(const std::shared_ptr<const RecordType> &);
+    virtual Value evalRator(const Value &) override;
+};
+
+struct RecordAccess : Unary {
+    std::shared_ptr<const RecordType> type;
+    size_t slot;
+    std::string name;           ///< Accessor name, for error messages
+    RecordAccess(const std::shared_ptr<const RecordType> &, size_t, const std::string &);
+    virtual Value evalRator(const Value &) override;
+};
+
+struct RecordModify : Binary {
+    std::shared_ptr<const RecordType> type;
+    size_t slot;
+    std::string name;           ///< Modifier name, for error messages
+    RecordModify(const std::shared_ptr<const RecordType> &, size_t, const std::string &);
+    virtual Value evalRator(const Value &, const Value &) override;
+};
+
+// ============================================================================
+// Multiple values
+// ============================================================================
+
+struct Values : Variadic {
+    Values(const std::vector<Expr> &);
+    virtual Value eval(Assoc &) override;
+    virtual Value evalRator(const std::vector<Value> &) override;
+};
+
+struct CallWithValues : Binary {
+    CallWithValues(const Expr &, const Expr &);
+    virtual Value evalRator(const Value &, const Value &) override;
+};
+
+// ============================================================================
+// Evaluation of data
+// ============================================================================
+
+/**
+ * @brief (eval datum [environment]): parses and evaluates a datum
+ *
+ * The parsed expression is cached per datum object, so a generated form
+ * evaluated repeatedly is converted and parsed only once.
+ */
+struct Eval : Variadic {
+    Eval(const std::vector<Expr> &);
+    virtual Value evalRator(const std::vector<Value> &) override;
+};
+
+struct InteractionEnv : ExprBase {
+    InteractionEnv();
+    virtual Value eval(Assoc &) override;
+};
+
+/**
+ * @brief Set while any per-call probe is on: profile, sample profile, trace or allocation profile
+ *
+ * Closure calls test this one flag and leave the probes to an out-of-line path.
+ */
+extern bool call_instrumentation_enabled;
+
+void resetEvaluator();
+
 #endif
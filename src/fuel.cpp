@@ -0,0 +1,76 @@
+/**
+ * @file fuel.cpp
+ * @brief Implementation of the step budget and the watchdog thread
+ */
+
+#include "fuel.hpp"
+#include "RE.hpp"
+#include <algorithm>
+#include <climits>
+#include <chrono>
+#include <thread>
+#include <iostream>
+#include <cstdio>
+
+std::atomic<long long> eval_fuel(LLONG_MAX);
+
+static std::atomic<bool> watchdog_tripped(false);
+static std::atomic<unsigned> watchdog_generation(0);   ///< Advanced by every arm and disarm
+static long long timeout_ms = 0;
+
+// Longest a superseded watchdog thread sleeps before noticing and exiting
+static const std::chrono::milliseconds WATCHDOG_POLL(10);
+
+void setStepLimit(long long steps) {
+    eval_fuel.store(steps, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Starts a detached thread that empties the tank after the deadline
+ *
+ * The evaluator may overwrite a single store with its own decrement, so the
+ * watchdog keeps storing zero until the evaluator has seen it. Pending
+ * stores only repeat once per millisecond, and only after the deadline.
+ * Arming again or disarming retires the thread, which then exits within
+ * one poll interval without touching the tank.
+ */
+bool armWatchdog(long long ms) {
+    unsigned generation = ++watchdog_generation;
+    watchdog_tripped.store(false);
+    timeout_ms = ms;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+    try {
+        std::thread([generation, deadline]() {
+            for (;;) {
+                if (watchdog_generation.load() != generation) return;
+                auto now = std::chrono::steady_clock::now();
+                if (now >= deadline) break;
+                std::this_thread::sleep_until(std::min(deadline, now + WATCHDOG_POLL));
+            }
+            watchdog_tripped.store(true);
+            while (watchdog_generation.load() == generation &&
+                   eval_fuel.load(std::memory_order_relaxed) > 0) {
+                eval_fuel.store(0, std::memory_order_relaxed);
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }).detach();
+    } catch (const std::system_error &) {
+        return false;
+    }
+    return true;
+}
+
+void disarmWatchdog() {
+    ++watchdog_generation;
+    watchdog_tripped.store(false);
+}
+
+void fuelExhausted() {
+    eval_fuel.store(0, std::memory_order_relaxed);
+    std::cout.flush();
+    std::fflush(stdout);
+    if (watchdog_tripped.load()) {
+        throw RuntimeError("time limit exceeded (" + std::to_string(timeout_ms) + " ms)");
+    }
+    throw RuntimeError("step limit exceeded");
+}
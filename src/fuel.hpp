@@ -0,0 +1,43 @@
+#ifndef FUEL_HPP
+#define FUEL_HPP
+
+/**
+ * @file fuel.hpp
+ * @brief Evaluation step budget (--max-steps) and wall-clock watchdog (--timeout-ms)
+ *
+ * Every procedure application spends one unit of fuel. The language has no
+ * looping forms, so each repetition, including the per-element callbacks of
+ * map, for-each and the folds, passes through an application. Without limits
+ * the tank starts practically infinite, so the check costs one decrement and
+ * one never-taken branch.
+ *
+ * The watchdog thread does not need a second check: when the deadline passes
+ * it empties the tank. Once either limit trips it stays tripped, so every
+ * later form fails immediately and the run ends quickly with its output
+ * flushed. The test runner re-arms both limits for every case.
+ */
+
+#include <atomic>
+
+extern std::atomic<long long> eval_fuel;
+
+void setStepLimit(long long);
+bool armWatchdog(long long);
+void disarmWatchdog();
+void fuelExhausted();
+
+/**
+ * @brief Spends one step, raising RuntimeError once a limit is reached
+ *
+ * The load and store are separate relaxed operations, plain moves rather
+ * than a locked read-modify-write, because only this thread decrements.
+ */
+inline void consumeFuel() {
+    long long left = eval_fuel.load(std::memory_order_relaxed) - 1;
+    eval_fuel.store(left, std::memory_order_relaxed);
+    if (left <= 0) {
+        fuelExhausted();
+    }
+}
+
+#endif // FUEL_HPP
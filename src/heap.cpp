@@ -0,0 +1,247 @@
+/**
+ * @file heap.cpp
+ * @brief Implementation of heap accounting and the memory ceiling
+ */
+
+#include "heap.hpp"
+#include "RE.hpp"
+#include "stats.hpp"
+#include "expr.hpp"
+#include <cstdlib>
+#include <new>
+#include <iomanip>
+#include <map>
+#include <tuple>
+#include <vector>
+#include <algorithm>
+
+HeapStats heap_stats = {};
+bool heap_accounting_enabled = false;
+
+bool alloc_profile_enabled = false;
+const std::string *alloc_procedure = nullptr;
+const ExprBase *alloc_expr = nullptr;
+
+namespace {
+
+// Procedure, ExprType (-1 when unknown), source line, category. Nodes of a
+// top-level form are freed once it has run, so the site keeps copies.
+typedef std::tuple<const std::string*, int, int, int> AllocSite;
+
+struct AllocSiteStats {
+    unsigned long long count;
+    unsigned long long bytes;
+};
+
+std::map<AllocSite, AllocSiteStats> alloc_sites;
+
+} // namespace
+
+// Clears every memoization table (defined in value.cpp)
+extern void clearMemoTables();
+
+// Size of the allocation whose object is being constructed, and category of
+// the object being destroyed. The constructor and destructor of a tracked
+// class run right after operator new and right before operator delete, so
+// these hand the missing half of the information across.
+static thread_local size_t constructing_size = 0;
+static thread_local int destroying_category = -1;
+
+void *heapAllocate(size_t size) {
+    if (heap_stats.max_bytes != 0 && heap_stats.live_bytes + size > heap_stats.max_bytes) {
+        heapReclaim();
+        if (heap_stats.live_bytes + size > heap_stats.max_bytes) {
+            throw RuntimeError("out of memory");
+        }
+    }
+    void *p = std::malloc(size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    heap_stats.live_bytes += size;
+    heap_stats.allocations++;
+    heap_stats.allocated_bytes += size;
+    if (!heap_accounting_enabled) return p;
+    if (heap_stats.live_bytes > heap_stats.peak_bytes) {
+        heap_stats.peak_bytes = heap_stats.live_bytes;
+    }
+    constructing_size = size;
+    return p;
+}
+
+void heapRelease(void *p, size_t size) {
+    if (p == nullptr) return;
+    std::free(p);
+    heap_stats.live_bytes -= size;
+    if (destroying_category >= 0) {
+        heap_stats.category_bytes[destroying_category] -= size;
+        destroying_category = -1;
+    }
+}
+
+/**
+ * @brief Records construction (or destruction) of an object of a category
+ */
+void heapTrack(int category, bool alive) {
+    if (alive) {
+        heap_stats.live_objects[category]++;
+        heap_stats.category_bytes[category] += constructing_size;
+        if (heap_stats.category_bytes[category] > heap_stats.category_peak[category]) {
+            heap_stats.category_peak[category] = heap_stats.category_bytes[category];
+        }
+        if (alloc_profile_enabled) {
+            int expr_type = alloc_expr != nullptr ? static_cast<int>(alloc_expr->e_type) : -1;
+            int line = alloc_expr != nullptr ? alloc_expr->line : 0;
+            AllocSiteStats &site = alloc_sites[AllocSite(alloc_procedure, expr_type, line, category)];
+            site.count++;
+            site.bytes += constructing_size;
+        }
+        constructing_size = 0;
+    } else {
+        heap_stats.live_objects[category]--;
+        destroying_category = category;
+    }
+}
+
+/**
+ * @brief Counts storage owned outside an object against the ceiling
+ *
+ * Charged before the storage is created, so a caller that is refused leaves
+ * nothing behind to undo.
+ */
+void heapCharge(size_t size) {
+    if (heap_stats.max_bytes != 0 && heap_stats.live_bytes + size > heap_stats.max_bytes) {
+        heapReclaim();
+        if (heap_stats.live_bytes + size > heap_stats.max_bytes) {
+            throw RuntimeError("out of memory");
+        }
+    }
+    heap_stats.live_bytes += size;
+    heap_stats.allocated_bytes += size;
+    if (heap_stats.live_bytes > heap_stats.peak_bytes) {
+        heap_stats.peak_bytes = heap_stats.live_bytes;
+    }
+    heap_stats.category_bytes[HEAP_STORAGE] += size;
+    if (heap_stats.category_bytes[HEAP_STORAGE] > heap_stats.category_peak[HEAP_STORAGE]) {
+        heap_stats.category_peak[HEAP_STORAGE] = heap_stats.category_bytes[HEAP_STORAGE];
+    }
+}
+
+void heapRefund(size_t size) {
+    heap_stats.live_bytes -= size;
+    heap_stats.category_bytes[HEAP_STORAGE] -= size;
+}
+
+void *heapAllocateStorage(size_t size) {
+    heapCharge(size);
+    void *p = std::malloc(size);
+    if (p == nullptr) {
+        heapRefund(size);
+        throw std::bad_alloc();
+    }
+    heap_stats.live_objects[HEAP_STORAGE]++;
+    return p;
+}
+
+void heapReleaseStorage(void *p, size_t size) {
+    if (p == nullptr) return;
+    std::free(p);
+    heap_stats.live_objects[HEAP_STORAGE]--;
+    heapRefund(size);
+}
+
+/**
+ * @brief Frees memory that is only held for speed before failing an allocation
+ */
+void heapReclaim() {
+    clearMemoTables();
+}
+
+/**
+ * @brief Parses a byte count with an optional K, M or G suffix (powers of 1024)
+ */
+bool parseByteSize(const std::string &s, size_t &bytes) {
+    char *end = nullptr;
+    unsigned long long n = std::strtoull(s.c_str(), &end, 10);
+    if (end == s.c_str()) return false;
+    std::string suffix(end);
+    if (suffix == "K" || suffix == "k") n <<= 10;
+    else if (suffix == "M" || suffix == "m") n <<= 20;
+    else if (suffix == "G" || suffix == "g") n <<= 30;
+    else if (!suffix.empty()) return false;
+    bytes = n;
+    return true;
+}
+
+/**
+ * @brief Report name of a ValueType, HEAP_STORAGE or HEAP_ENVIRONMENT
+ */
+const char *heapCategoryName(int category) {
+    switch (category) {
+        case V_INT: return "int";
+        case V_RATIONAL: return "rational";
+        case V_REAL: return "real";
+        case V_BOOL: return "bool";
+        case V_SYM: return "symbol";
+        case V_NULL: return "null";
+        case V_STRING: return "string";
+        case V_PAIR: return "pair";
+        case V_PROC: return "procedure";
+        case V_PRIMITIVE: return "primitive";
+        case V_RECORD: return "record";
+        case V_VALUES: return "values";
+        case V_ENVIRONMENT: return "env-object";
+        case V_VOID: return "void";
+        case V_TERMINATE: return "terminate";
+        case HEAP_STORAGE: return "storage";
+        case HEAP_ENVIRONMENT: return "environment";
+        default: return "other";
+    }
+}
+
+void printHeapStats(std::ostream &os) {
+    os << "heap: peak " << heap_stats.peak_bytes << " bytes, live "
+       << heap_stats.live_bytes << " bytes\n";
+    for (int i = 0; i < HEAP_CATEGORIES; ++i) {
+        if (heap_stats.live_objects[i] == 0 && heap_stats.category_bytes[i] == 0) continue;
+        os << "  " << std::left << std::setw(12) << heapCategoryName(i) << std::right
+           << std::setw(10) << heap_stats.live_objects[i] << " objects "
+           << std::setw(12) << heap_stats.category_bytes[i] << " bytes\n";
+    }
+}
+
+/**
+ * @brief Reports allocation sites by bytes, then peak and exit-time live bytes per type
+ */
+void printAllocProfile(std::ostream &os) {
+    std::vector<std::pair<AllocSite, AllocSiteStats>> sorted(alloc_sites.begin(), alloc_sites.end());
+    std::sort(sorted.begin(), sorted.end(),
+              [](const std::pair<AllocSite, AllocSiteStats> &a, const std::pair<AllocSite, AllocSiteStats> &b) {
+                  return a.second.bytes > b.second.bytes;
+              });
+    os << std::left << std::setw(24) << "procedure" << std::setw(20) << "expression"
+       << std::setw(12) << "type" << std::right << std::setw(12) << "objects"
+       << std::setw(14) << "bytes" << "\n";
+    for (const auto &entry : sorted) {
+        const std::string *procedure = std::get<0>(entry.first);
+        int expr_type = std::get<1>(entry.first);
+        int line = std::get<2>(entry.first);
+        std::string expression = "?";
+        if (expr_type >= 0) {
+            expression = exprTypeName(static_cast<ExprType>(expr_type));
+            if (line != 0) expression += "@" + std::to_string(line);
+        }
+        os << std::left << std::setw(24) << (procedure != nullptr ? *procedure : "<toplevel>")
+           << std::setw(20) << expression
+           << std::setw(12) << heapCategoryName(std::get<3>(entry.first)) << std::right
+           << std::setw(12) << entry.second.count << std::setw(14) << entry.second.bytes << "\n";
+    }
+    os << "peak and exit-time live bytes per type:\n";
+    for (int i = 0; i < HEAP_CATEGORIES; ++i) {
+        if (heap_stats.category_peak[i] == 0) continue;
+        os << "  " << std::left << std::setw(12) << heapCategoryName(i) << std::right
+           << std::setw(14) << heap_stats.category_peak[i] << " peak "
+           << std::setw(14) << heap_stats.category_bytes[i] << " live "
+           << std::setw(10) << heap_stats.live_objects[i] << " objects\n";
+    }
+}
@@ -0,0 +1,133 @@
+#ifndef HEAP_HPP
+#define HEAP_HPP
+
+/**
+ * @file heap.hpp
+ * @brief Heap accounting and memory ceiling for interpreter objects
+ *
+ * Every Value and environment frame is allocated through the class-level
+ * operator new/delete of ValueBase and AssocList, which report to this
+ * module. Live bytes and allocation totals are always kept, a few counter
+ * adds per object, for (time ...), heap-live-bytes and heap-allocations.
+ *
+ * Everything else needs heap_accounting_enabled, which main sets for
+ * --max-heap, --heap-stats, --alloc-profile and --run-tests before anything
+ * is allocated: peaks, counts per value type, allocation sites, and the
+ * optional --max-heap ceiling. When an allocation would exceed the ceiling,
+ * caches are dropped first and, if that is not enough,
+ * RuntimeError("out of memory") is raised for the REPL to report like any
+ * other error. Storage a value owns outside its object is then charged to
+ * the "storage" category too: reference-count blocks (through
+ * HeapAllocator), string character buffers and memo table entries. What
+ * remains uncounted is malloc's own per-block overhead and parse-time data
+ * such as symbol names and code, so the process footprint exceeds the
+ * ceiling by a small constant factor.
+ *
+ * With --alloc-profile every allocation is also attributed to a site: the
+ * procedure being applied (by its lambda's name) and the expression being
+ * evaluated, by its kind and source line. EVAL_STATS_SCOPE maintains the
+ * expression, so builds without SCHEME_EVAL_STATS name only the procedure.
+ */
+
+#include "Def.hpp"
+#include <cstddef>
+#include <string>
+
+const int HEAP_CATEGORIES = 32;      ///< Slots for ValueType plus the environment
+const int HEAP_STORAGE = 30;         ///< Slot for storage owned outside objects
+const int HEAP_ENVIRONMENT = 31;     ///< Slot used for AssocList frames
+
+struct HeapStats {
+    size_t live_bytes;
+    size_t peak_bytes;
+    size_t max_bytes;                        ///< Ceiling, 0 for unlimited
+    unsigned long long allocations;          ///< Objects allocated since start
+    unsigned long long allocated_bytes;      ///< Bytes allocated since start
+    size_t live_objects[HEAP_CATEGORIES];
+    size_t category_bytes[HEAP_CATEGORIES];  ///< Live bytes per category
+    size_t category_peak[HEAP_CATEGORIES];   ///< Peak live bytes per category
+};
+
+extern HeapStats heap_stats;
+extern bool heap_accounting_enabled;
+
+struct ExprBase;
+
+extern bool alloc_profile_enabled;
+extern const std::string *alloc_procedure;   ///< Null at top level
+extern const ExprBase *alloc_expr;           ///< Null when unknown
+
+void *heapAllocate(size_t);
+void heapRelease(void *, size_t);
+void heapTrack(int, bool);
+void heapCharge(size_t);
+void heapRefund(size_t);
+void *heapAllocateStorage(size_t);
+void heapReleaseStorage(void *, size_t);
+void heapReclaim();
+bool parseByteSize(const std::string &, size_t &);
+const char *heapCategoryName(int);
+void printHeapStats(std::ostream &);
+void printAllocProfile(std::ostream &);
+
+/**
+ * @brief Standard allocator that charges its blocks to HEAP_STORAGE
+ *
+ * Passed to shared_ptr so that reference-count blocks count against the
+ * ceiling along with the objects they manage.
+ */
+template <typename T>
+struct HeapAllocator {
+    typedef T value_type;
+    HeapAllocator() {}
+    template <typename U>
+    HeapAllocator(const HeapAllocator<U> &) {}
+    T *allocate(size_t n) {
+        return static_cast<T*>(heapAllocateStorage(n * sizeof(T)));
+    }
+    void deallocate(T *p, size_t n) {
+        heapReleaseStorage(p, n * sizeof(T));
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const HeapAllocator<T> &, const HeapAllocator<U> &) { return true; }
+
+template <typename T, typename U>
+bool operator!=(const HeapAllocator<T> &, const HeapAllocator<U> &) { return false; }
+
+/**
+ * @brief Makes a procedure the allocation site for the extent of its call
+ */
+class AllocSiteScope {
+    bool active;
+    const std::string *saved;
+public:
+    explicit AllocSiteScope(const std::string *name) : active(alloc_profile_enabled), saved(nullptr) {
+        if (!active) return;
+        saved = alloc_procedure;
+        alloc_procedure = name;
+    }
+    ~AllocSiteScope() {
+        if (active) alloc_procedure = saved;
+    }
+};
+
+/**
+ * @brief Makes an expression the allocation site for the extent of its evaluation
+ */
+class AllocExprScope {
+    bool active;
+    const ExprBase *saved;
+public:
+    explicit AllocExprScope(const ExprBase *expr) : active(alloc_profile_enabled), saved(nullptr) {
+        if (!active) return;
+        saved = alloc_expr;
+        alloc_expr = expr;
+    }
+    ~AllocExprScope() {
+        if (active) alloc_expr = saved;
+    }
+};
+
+#endif // HEAP_HPP
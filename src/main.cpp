@@ -3,9 +3,21 @@
 #include "expr.hpp"
 #include "value.hpp"
 #include "RE.hpp"
+#include "heap.hpp"
+#include "stats.hpp"
+#include "profile.hpp"
+#include "trace.hpp"
+#include "snapshot.hpp"
+#include "fuel.hpp"
+#include "runner.hpp"
+#include <fstream>
 #include <sstream>
 #include <iostream>
 #include <map>
+#include <cstdlib>
+#include <climits>
+#include <unistd.h>
+#include <vector>
 
 extern std::map<std::string, ExprType> primitives;
 extern std::map<std::string, ExprType> reserved_words;
@@ -45,18 +57,35 @@ bool isExplicitVoidCall(Expr expr) {
     return false;
 }
 
-void REPL(){
+static Expr traceParse(Syntax &stx, Assoc &env, long form) {
+    TraceScope span("parse", form);
+    return stx -> parse(env);
+}
+
+static Value traceEval(Expr &expr, Assoc &env, long form) {
+    TraceScope span("eval", form);
+    return expr -> eval(env);
+}
+
+void REPL(std::istream &in, const std::string &snapshot_path){
     // read - evaluation - print loop
     Assoc global_env = empty();
+    snapshot_root = &global_env;
+    interaction_env = &global_env;
+    syntax_line = 1;
+    long form = 0;
     while (1){
         #ifndef ONLINE_JUDGE
             std::cout << "scm> ";
         #endif
-        Syntax stx = readSyntax(std :: cin); // read
+        if (readSpace(in).peek() == EOF)
+            break;
+        Syntax stx = readSyntax(in); // read
+        TraceScope form_span("form", ++form);
         try{
-            Expr expr = stx -> parse(global_env); // parse
+            Expr expr = traceParse(stx, global_env, form); // parse
             // stx -> show(std :: cout); // syntax print
-            Value val = expr -> eval(global_env);
+            Value val = traceEval(expr, global_env, form);
             if (val -> v_type == V_TERMINATE)
                 break;
             // Only print void if it's an explicit (void) call
@@ -70,12 +99,158 @@ void REPL(){
             std :: cout << "RuntimeError: " << RE.message();
             // std :: cout << "RuntimeError";
         }
-        puts("");
+        std :: cout << '\n';
     }
+    if (!snapshot_path.empty()) {
+        std::ofstream snapshot(snapshot_path);
+        writeHeapSnapshot(snapshot, global_env);
+    }
+    snapshot_root = nullptr;
+    interaction_env = nullptr;
+    resetEvaluator();
 }
 
 
 int main(int argc, char *argv[]) {
-    REPL();
+    bool heap_report = false;
+    std::string stats_json_path;
+    std::string profile_folded_path;
+    std::string sample_profile_path;
+    std::string trace_path;
+    std::string snapshot_path;
+    long sample_interval_us = 1000;
+    long long timeout_ms = 0;
+    long long step_limit = LLONG_MAX;
+    std::string tests_dir;
+    int jobs = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 11, "--max-heap=") == 0) {
+            if (!parseByteSize(arg.substr(11), heap_stats.max_bytes)) {
+                std::cerr << "invalid --max-heap value: " << arg.substr(11) << std::endl;
+                return 1;
+            }
+        } else if (arg.compare(0, 12, "--max-steps=") == 0) {
+            char *end = nullptr;
+            long long steps = std::strtoll(arg.c_str() + 12, &end, 10);
+            if (end == arg.c_str() + 12 || *end != '\0' || steps <= 0) {
+                std::cerr << "invalid --max-steps value: " << arg.substr(12) << std::endl;
+                return 1;
+            }
+            setStepLimit(steps);
+            step_limit = steps;
+        } else if (arg.compare(0, 13, "--timeout-ms=") == 0) {
+            char *end = nullptr;
+            timeout_ms = std::strtoll(arg.c_str() + 13, &end, 10);
+            if (end == arg.c_str() + 13 || *end != '\0' || timeout_ms <= 0) {
+                std::cerr << "invalid --timeout-ms value: " << arg.substr(13) << std::endl;
+                return 1;
+            }
+        } else if (arg == "--run-tests" && i + 1 < argc) {
+            tests_dir = argv[++i];
+        } else if (arg.compare(0, 12, "--run-tests=") == 0) {
+            tests_dir = arg.substr(12);
+        } else if (arg.compare(0, 7, "--jobs=") == 0) {
+            jobs = std::atoi(arg.c_str() + 7);
+            if (jobs <= 0) {
+                jobs = sysconf(_SC_NPROCESSORS_ONLN);
+            }
+        } else if (arg == "--heap-stats") {
+            heap_report = true;
+        } else if (arg == "--heap-snapshot-at-exit") {
+            snapshot_path = "heap-snapshot.json";
+        } else if (arg.compare(0, 24, "--heap-snapshot-at-exit=") == 0) {
+            snapshot_path = arg.substr(24);
+        } else if (arg == "--alloc-profile") {
+            alloc_profile_enabled = true;
+        } else if (arg == "--stats") {
+            eval_stats_enabled = true;
+        } else if (arg.compare(0, 13, "--stats-json=") == 0) {
+            eval_stats_enabled = true;
+            stats_json_path = arg.substr(13);
+        } else if (arg == "--profile") {
+            profile_enabled = true;
+        } else if (arg.compare(0, 17, "--profile-folded=") == 0) {
+            profile_enabled = true;
+            profile_folded_path = arg.substr(17);
+        } else if (arg.compare(0, 17, "--sample-profile=") == 0) {
+            sample_profile_path = arg.substr(17);
+        } else if (arg.compare(0, 21, "--sample-interval-us=") == 0) {
+            sample_interval_us = std::atol(arg.substr(21).c_str());
+            if (sample_interval_us <= 0) {
+                std::cerr << "invalid --sample-interval-us value: " << arg.substr(21) << std::endl;
+                return 1;
+            }
+        } else if (arg.compare(0, 8, "--trace=") == 0) {
+            trace_path = arg.substr(8);
+        } else if (arg.compare(0, 21, "--trace-threshold-us=") == 0) {
+            char *end = nullptr;
+            trace_threshold_ns = std::strtoull(arg.c_str() + 21, &end, 10) * 1000;
+            if (end == arg.c_str() + 21 || *end != '\0') {
+                std::cerr << "invalid --trace-threshold-us value: " << arg.substr(21) << std::endl;
+                return 1;
+            }
+        } else {
+            std::cerr << "unknown option: " << arg << std::endl;
+            return 1;
+        }
+    }
+    heap_accounting_enabled = heap_stats.max_bytes != 0 || heap_report || alloc_profile_enabled ||
+                              !tests_dir.empty();
+#ifndef SCHEME_EVAL_STATS
+    if (eval_stats_enabled) {
+        std::cerr << "evaluation statistics are not compiled in (SCHEME_EVAL_STATS)" << std::endl;
+    }
+#endif
+    if (!sample_profile_path.empty() && !startSampleProfile(sample_interval_us)) {
+        std::cerr << "cannot start the sampling profiler" << std::endl;
+        return 1;
+    }
+    call_instrumentation_enabled = profile_enabled || sample_profile_enabled || !trace_path.empty() ||
+                                   alloc_profile_enabled;
+    if (!tests_dir.empty()) {
+        return runTests(tests_dir, jobs, step_limit, timeout_ms);
+    }
+    if (timeout_ms > 0 && !armWatchdog(timeout_ms)) {
+        std::cerr << "cannot start the --timeout-ms watchdog" << std::endl;
+        return 1;
+    }
+    if (!trace_path.empty()) {
+        setTraceCapacity(TRACE_CAPACITY);
+        trace_enabled = true;
+    }
+    REPL(std::cin, snapshot_path);
+    if (!trace_path.empty()) {
+        trace_enabled = false;
+        std::vector<char> buffer(1 << 16);   // Must outlive the stream
+        std::ofstream trace_file;
+        trace_file.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+        trace_file.open(trace_path);
+        writeTrace(trace_file);
+    }
+    if (!sample_profile_path.empty()) {
+        stopSampleProfile();
+        std::ofstream folded(sample_profile_path);
+        writeSampleProfile(folded);
+    }
+    if (heap_report) {
+        printHeapStats(std::cerr);
+    }
+    if (alloc_profile_enabled) {
+        printAllocProfile(std::cerr);
+    }
+    if (eval_stats_enabled && stats_json_path.empty()) {
+        printEvalStats(std::cerr);
+    } else if (eval_stats_enabled) {
+        std::ofstream json(stats_json_path);
+        writeEvalStatsJson(json);
+    }
+    if (profile_enabled) {
+        printProfile(std::cerr);
+    }
+    if (!profile_folded_path.empty()) {
+        std::ofstream folded(profile_folded_path);
+        writeProfileFolded(folded);
+    }
     return 0;
 }
@@ -23,6 +23,380 @@ using std::pair;
 
 extern std::map<std::string, ExprType> primitives;
 extern std::map<std::string, ExprType> reserved_words;
+extern std::map<std::string, ExprType> library_procedures;
+extern std::map<std::string, ExprType> library_syntax;
+
+/**
+ * @brief Value of parse-time frames that have a runtime counterpart
+ *
+ * Lambda parameters, let and letrec variables and the internal defines of a
+ * body are bound at runtime in exactly the order the parser binds them, so a
+ * frame's index from the head of the parse scope is its index at runtime.
+ */
+static const Value &mirroredFrame() {
+    static Value marker = VoidV();
+    return marker;
+}
+
+/**
+ * @brief Binds names in a parse-time scope
+ *
+ * Only the presence of a binding matters during parsing: a locally bound
+ * identifier shadows any primitive or reserved word of the same name, so
+ * (let ((list ...)) (list 1 2)) parses as an application of the local.
+ */
+static Assoc extendScope(const vector<string> &names, Assoc env, bool mirrored = false) {
+    for (const auto &name : names) {
+        env = extend(name, mirrored ? mirroredFrame() : VoidV(), env);
+    }
+    return env;
+}
+
+/**
+ * @brief Resolves the frame an assignment to name stores into
+ *
+ * Returns the index of the binding frame when it and every frame before it
+ * have a runtime counterpart, or -1. Frames the parser cannot see, such as
+ * those of a define nested in a begin, only ever sit in front of the mirrored
+ * ones, so the evaluator checks the name at the index and walks the
+ * environment when it does not match.
+ */
+static int lexicalAddress(const string &name, Assoc &env) {
+    int depth = 0;
+    for (AssocList *frame = env.get(); frame != nullptr; frame = frame->next.get(), ++depth) {
+        if (frame->v.get() != mirroredFrame().get()) return -1;
+        if (frame->x == name) return depth;
+    }
+    return -1;
+}
+
+/**
+ * @brief Scope in which the value of (define name ...) is parsed
+ *
+ * A name the scope already binds, such as an internal define collected by
+ * the enclosing body, needs no frame of its own. Reusing the scope keeps
+ * the frames of an enclosing body resolvable by lexicalAddress.
+ */
+static Assoc defineScope(const string &name, Assoc &env) {
+    if (findBinding(name, env) != nullptr) return env;
+    return extendScope({name}, env);
+}
+
+/**
+ * @brief Collects names introduced by internal defines in a body
+ */
+static void collectDefines(const vector<Syntax> &stxs, size_t from, Assoc &env, vector<string> &names) {
+    if (find("define", env).get() != nullptr) return;
+    for (size_t i = from; i < stxs.size(); ++i) {
+        List *form = dynamic_cast<List*>(stxs[i].get());
+        if (form == nullptr || form->stxs.size() < 2) continue;
+        SymbolSyntax *head = dynamic_cast<SymbolSyntax*>(form->stxs[0].get());
+        if (head == nullptr || head->s != "define") continue;
+        SymbolSyntax *var_sym = dynamic_cast<SymbolSyntax*>(form->stxs[1].get());
+        List *func_def = dynamic_cast<List*>(form->stxs[1].get());
+        if (var_sym != nullptr) {
+            names.push_back(var_sym->s);
+        } else if (func_def != nullptr && !func_def->stxs.empty()) {
+            SymbolSyntax *func_name = dynamic_cast<SymbolSyntax*>(func_def->stxs[0].get());
+            if (func_name != nullptr) names.push_back(func_name->s);
+        }
+    }
+}
+
+/**
+ * @brief Interns a procedure name
+ *
+ * Names are shared by every closure of a lambda and never freed, so the
+ * profilers may hold raw pointers to them, including from a signal handler.
+ */
+static std::shared_ptr<const string> procedureName(const string &name) {
+    static std::map<string, std::shared_ptr<const string>> names;
+    std::shared_ptr<const string> &interned = names[name];
+    if (!interned) {
+        interned = std::make_shared<const string>(name);
+    }
+    return interned;
+}
+
+/**
+ * @brief Names a lambda after the variable it is bound to, for profiling
+ */
+static void nameLambda(const Expr &expr, const string &name) {
+    Expr target = expr;
+    Begin *begin = dynamic_cast<Begin*>(target.get());
+    if (begin != nullptr && begin->es.size() == 1) {
+        target = begin->es[0];
+    }
+    Lambda *lambda = dynamic_cast<Lambda*>(target.get());
+    if (lambda != nullptr) {
+        lambda->code->name = procedureName(name);
+    }
+}
+
+/**
+ * @brief Free-variable tracking for the lambdas being parsed
+ *
+ * Each open lambda remembers the scope it is parsed in. A reference is bound
+ * inside the lambda when the parse-time scope binds the name before reaching
+ * that boundary; otherwise it is free there. A lambda with no free
+ * references never consults its closure environment.
+ */
+struct LambdaScope {
+    AssocList *boundary;    ///< Innermost frame outside the lambda
+    bool has_free;
+};
+
+static vector<LambdaScope> lambda_scopes;
+
+// Keeps lambda_scopes balanced when parsing a body throws
+struct LambdaScopeGuard {
+    explicit LambdaScopeGuard(Assoc &env) {
+        lambda_scopes.push_back(LambdaScope{env.get(), false});
+    }
+    ~LambdaScopeGuard() {
+        lambda_scopes.pop_back();
+    }
+};
+
+/**
+ * @brief Marks every open lambda in which a reference to name is free
+ */
+static void noteReference(const string &name, Assoc &env) {
+    AssocList *frame = env.get();
+    for (size_t k = lambda_scopes.size(); k-- > 0;) {
+        LambdaScope &scope = lambda_scopes[k];
+        for (; frame != scope.boundary; frame = frame->next.get()) {
+            if (frame->x == name) return;
+        }
+        scope.has_free = true;
+    }
+}
+
+/**
+ * @brief Parses the body forms stxs[from..] in a scope extended with names
+ *
+ * The names of internal defines are stored in locals, which the construct
+ * owning the body binds right after its own variables, so the runtime frames
+ * match the parse scope.
+ */
+static Expr parseBody(vector<Syntax> &stxs, size_t from, vector<string> names, Assoc &env,
+                      vector<string> &locals) {
+    size_t bound = names.size();
+    collectDefines(stxs, from, env, names);
+    Assoc body_env = extendScope(names, env, true);
+    vector<Expr> body_exprs;
+    for (size_t i = from; i < stxs.size(); ++i) {
+        body_exprs.push_back(stxs[i].parse(body_env));
+    }
+    locals.assign(names.begin() + bound, names.end());
+    return Expr(new Begin(body_exprs));
+}
+
+/**
+ * @brief Parses a lambda body and builds the code object its closures share
+ */
+static Expr parseLambda(const vector<string> &params, vector<Syntax> &stxs, size_t from,
+                        Assoc &env, const string &name) {
+    LambdaScopeGuard guard(env);
+    vector<string> locals;
+    Lambda *lambda = new Lambda(params, parseBody(stxs, from, params, env, locals));
+    lambda->code->locals = locals;
+    lambda->closed = !lambda_scopes.back().has_free;
+    lambda->code->name = procedureName(name);
+    return Expr(lambda);
+}
+
+/**
+ * @brief Native node of a library procedure, checking the argument count
+ */
+static Expr libraryNode(ExprType op_type, const string &op, vector<Expr> &parameters) {
+    if (op_type == E_MAP) {
+        if (parameters.size() < 2) {
+            throw RuntimeError("Wrong number of arguments for map");
+        }
+        return Expr(new MapFunc(parameters));
+    } else if (op_type == E_FOREACH) {
+        if (parameters.size() < 2) {
+            throw RuntimeError("Wrong number of arguments for for-each");
+        }
+        return Expr(new ForEach(parameters));
+    } else if (op_type == E_FILTER) {
+        if (parameters.size() != 2) {
+            throw RuntimeError("Wrong number of arguments for filter");
+        }
+        return Expr(new Filter(parameters[0], parameters[1]));
+    } else if (op_type == E_FOLDL) {
+        if (parameters.size() < 3) {
+            throw RuntimeError("Wrong number of arguments for fold-left");
+        }
+        return Expr(new FoldLeft(parameters));
+    } else if (op_type == E_FOLDR) {
+        if (parameters.size() < 3) {
+            throw RuntimeError("Wrong number of arguments for fold-right");
+        }
+        return Expr(new FoldRight(parameters));
+    } else if (op_type == E_REDUCE) {
+        if (parameters.size() != 3) {
+            throw RuntimeError("Wrong number of arguments for reduce");
+        }
+        return Expr(new Reduce(parameters));
+    } else if (op_type == E_APPLYPROC) {
+        if (parameters.size() < 2) {
+            throw RuntimeError("Wrong number of arguments for apply");
+        }
+        return Expr(new ApplyProc(parameters));
+    } else if (op_type == E_LENGTH) {
+        if (parameters.size() != 1) {
+            throw RuntimeError("Wrong number of arguments for length");
+        }
+        return Expr(new Length(parameters[0]));
+    } else if (op_type == E_APPEND) {
+        return Expr(new Append(parameters));
+    } else if (op_type == E_REVERSE) {
+        if (parameters.size() != 1) {
+            throw RuntimeError("Wrong number of arguments for reverse");
+        }
+        return Expr(new Reverse(parameters[0]));
+    } else if (op_type == E_LISTREF) {
+        if (parameters.size() != 2) {
+            throw RuntimeError("Wrong number of arguments for list-ref");
+        }
+        return Expr(new ListRef(parameters[0], parameters[1]));
+    } else if (op_type == E_LISTTAIL) {
+        if (parameters.size() != 2) {
+            throw RuntimeError("Wrong number of arguments for list-tail");
+        }
+        return Expr(new ListTail(parameters[0], parameters[1]));
+    } else if (op_type == E_MEMQ) {
+        if (parameters.size() != 2) {
+            throw RuntimeError("Wrong number of arguments for memq");
+        }
+        return Expr(new Memq(parameters[0], parameters[1]));
+    } else if (op_type == E_MEMBER) {
+        if (parameters.size() != 2) {
+            throw RuntimeError("Wrong number of arguments for member");
+        }
+        return Expr(new Member(parameters[0], parameters[1]));
+    } else if (op_type == E_ASSQ) {
+        if (parameters.size() != 2) {
+            throw RuntimeError("Wrong number of arguments for assq");
+        }
+        return Expr(new Assq(parameters[0], parameters[1]));
+    } else if (op_type == E_ASSOC) {
+        if (parameters.size() != 2) {
+            throw RuntimeError("Wrong number of arguments for assoc");
+        }
+        return Expr(new AssocFunc(parameters[0], parameters[1]));
+    } else if (op_type == E_SORT) {
+        if (parameters.size() != 2) {
+            throw RuntimeError("Wrong number of arguments for sort");
+        }
+        return Expr(new Sort(parameters[0], parameters[1]));
+    } else if (op_type == E_LISTSORT) {
+        if (parameters.size() != 2) {
+            throw RuntimeError("Wrong number of arguments for list-sort");
+        }
+        return Expr(new ListSort(parameters[0], parameters[1]));
+    } else if (op_type == E_MEMOIZE) {
+        if (parameters.size() != 1 && parameters.size() != 2) {
+            throw RuntimeError("Wrong number of arguments for memoize");
+        }
+        return Expr(new Memoize(parameters));
+    } else if (op_type == E_MEMOSTATS) {
+        if (parameters.size() != 1) {
+            throw RuntimeError("Wrong number of arguments for memoize-stats");
+        }
+        return Expr(new MemoStats(parameters[0]));
+    } else if (op_type == E_EQUALQ) {
+        if (parameters.size() != 2) {
+            throw RuntimeError("Wrong number of arguments for equal?");
+        }
+        return Expr(new IsEqual(parameters[0], parameters[1]));
+    } else if (op_type == E_STRING_APPEND) {
+        return Expr(new StringAppend(parameters));
+    } else if (op_type == E_SUBSTRING) {
+        if (parameters.size() != 2 && parameters.size() != 3) {
+            throw RuntimeError("Wrong number of arguments for substring");
+        }
+        return Expr(new Substring(parameters));
+    } else if (op_type == E_STRING_LENGTH) {
+        if (parameters.size() != 1) {
+            throw RuntimeError("Wrong number of arguments for string-length");
+        }
+        return Expr(new StringLength(parameters[0]));
+    } else if (op_type == E_STRING_TO_SYMBOL) {
+        if (parameters.size() != 1) {
+            throw RuntimeError("Wrong number of arguments for string->symbol");
+        }
+        return Expr(new StringToSymbol(parameters[0]));
+    } else if (op_type == E_NUMBER_TO_STRING) {
+        if (parameters.size() != 1) {
+            throw RuntimeError("Wrong number of arguments for number->string");
+        }
+        return Expr(new NumberToString(parameters[0]));
+    } else if (op_type == E_EXACT_TO_INEXACT) {
+        if (parameters.size() != 1) {
+            throw RuntimeError("Wrong number of arguments for exact->inexact");
+        }
+        return Expr(new ExactToInexact(parameters[0]));
+    } else if (op_type == E_INEXACT_TO_EXACT) {
+        if (parameters.size() != 1) {
+            throw RuntimeError("Wrong number of arguments for inexact->exact");
+        }
+        return Expr(new InexactToExact(parameters[0]));
+    } else if (op_type == E_DUMP_HEAP) {
+        if (parameters.size() != 1) {
+            throw RuntimeError("Wrong number of arguments for dump-heap");
+        }
+        return Expr(new DumpHeap(parameters[0]));
+    } else if (op_type == E_HEAP_LIVE_BYTES) {
+        if (parameters.size() != 0) {
+            throw RuntimeError("Wrong number of arguments for heap-live-bytes");
+        }
+        return Expr(new HeapLiveBytes());
+    } else if (op_type == E_HEAP_ALLOCATIONS) {
+        if (parameters.size() != 0) {
+            throw RuntimeError("Wrong number of arguments for heap-allocations");
+        }
+        return Expr(new HeapAllocations());
+    } else if (op_type == E_CURRENT_TIME_NS) {
+        if (parameters.size() != 0) {
+            throw RuntimeError("Wrong number of arguments for current-time-ns");
+        }
+        return Expr(new CurrentTimeNs());
+    } else if (op_type == E_VALUES) {
+        return Expr(new Values(parameters));
+    } else if (op_type == E_CALL_WITH_VALUES) {
+        if (parameters.size() != 2) {
+            throw RuntimeError("Wrong number of arguments for call-with-values");
+        }
+        return Expr(new CallWithValues(parameters[0], parameters[1]));
+    } else if (op_type == E_EVAL) {
+        if (parameters.size() != 1 && parameters.size() != 2) {
+            throw RuntimeError("Wrong number of arguments for eval");
+        }
+        return Expr(new Eval(parameters));
+    } else if (op_type == E_INTERACTION_ENV) {
+        if (parameters.size() != 0) {
+            throw RuntimeError("Wrong number of arguments for interaction-environment");
+        }
+        return Expr(new InteractionEnv());
+    } else {
+        throw RuntimeError("Unknown library procedure: " + op);
+    }
+}
+
+// Stamps the nodes built while parsing a form with its source line; a
+// synthesized form keeps the line of the form that encloses it
+struct ParseLineGuard {
+    int saved;
+    explicit ParseLineGuard(int line) : saved(parse_line) {
+        if (line != 0) parse_line = line;
+    }
+    ~ParseLineGuard() {
+        parse_line = saved;
+    }
+};
 
 /**
  * @brief Syntax wrapper parse method - delegates to underlying SyntaxBase
@@ -39,7 +413,12 @@ Expr RationalSyntax::parse(Assoc &env) {
     return Expr(new RationalNum(numerator, denominator));
 }
 
+Expr RealSyntax::parse(Assoc &env) {
+    return Expr(new RealNum(x));
+}
+
 Expr SymbolSyntax::parse(Assoc &env) {
+    noteReference(s, env);
     return Expr(new Var(s));
 }
 
@@ -56,6 +435,7 @@ Expr FalseSyntax::parse(Assoc &env) {
 }
 
 Expr List::parse(Assoc &env) {
+    ParseLineGuard line_guard(line);
     if (stxs.empty()) {
         return Expr(new Quote(Syntax(new List())));
     }
@@ -254,6 +634,44 @@ Expr List::parse(Assoc &env) {
         }
     }
 
+    // Check if it's a native library procedure
+    if (library_procedures.count(op) != 0) {
+        vector<Expr> parameters;
+        for (size_t i = 1; i < stxs.size(); ++i) {
+            parameters.push_back(stxs[i].parse(env));
+        }
+
+        ExprType op_type = library_procedures[op];
+        // A top-level define may still rebind the name before the call runs,
+        // so an arity mismatch only matters if it does not
+        Expr native(nullptr);
+        string arity_error;
+        try {
+            native = libraryNode(op_type, op, parameters);
+        } catch (const RuntimeError &error) {
+            arity_error = error.message();
+        }
+        return Expr(new LibraryCall(op, op_type, native, parameters, arity_error));
+    }
+
+    // Check if it's a special form that user code could have bound instead
+    if (library_syntax.count(op) != 0) {
+        switch (library_syntax[op]) {
+            case E_TIME: {
+                if (stxs.size() < 2) {
+                    throw RuntimeError("Wrong number of arguments for time");
+                }
+                vector<Expr> exprs;
+                for (size_t i = 1; i < stxs.size(); ++i) {
+                    exprs.push_back(stxs[i].parse(env));
+                }
+                return Expr(new Time(Expr(new Begin(exprs))));
+            }
+            default:
+                throw RuntimeError("Unknown special form: " + op);
+        }
+    }
+
     // Check if it's a reserved word
     if (reserved_words.count(op) != 0) {
         switch (reserved_words[op]) {
@@ -307,11 +725,7 @@ Expr List::parse(Assoc &env) {
                     }
                     params.push_back(param_sym->s);
                 }
-                vector<Expr> body_exprs;
-                for (size_t i = 2; i < stxs.size(); ++i) {
-                    body_exprs.push_back(stxs[i].parse(env));
-                }
-                return Expr(new Lambda(params, Expr(new Begin(body_exprs))));
+                return parseLambda(params, stxs, 2, env, "lambda@" + std::to_string(line));
             }
             case E_DEFINE: {
                 if (stxs.size() < 3) {
@@ -320,11 +734,14 @@ Expr List::parse(Assoc &env) {
                 SymbolSyntax *var_sym = dynamic_cast<SymbolSyntax*>(stxs[1].get());
                 if (var_sym != nullptr) {
                     // Simple variable definition
+                    Assoc def_env = defineScope(var_sym->s, env);
                     vector<Expr> body_exprs;
                     for (size_t i = 2; i < stxs.size(); ++i) {
-                        body_exprs.push_back(stxs[i].parse(env));
+                        body_exprs.push_back(stxs[i].parse(def_env));
                     }
-                    return Expr(new Define(var_sym->s, Expr(new Begin(body_exprs))));
+                    Expr body(new Begin(body_exprs));
+                    nameLambda(body, var_sym->s);
+                    return Expr(new Define(var_sym->s, body, lexicalAddress(var_sym->s, env)));
                 }
                 // Function definition shorthand
                 List *func_def = dynamic_cast<List*>(stxs[1].get());
@@ -343,11 +760,34 @@ Expr List::parse(Assoc &env) {
                     }
                     params.push_back(param_sym->s);
                 }
-                vector<Expr> body_exprs;
-                for (size_t i = 2; i < stxs.size(); ++i) {
-                    body_exprs.push_back(stxs[i].parse(env));
+                Assoc def_env = defineScope(func_name->s, env);
+                Expr lambda = parseLambda(params, stxs, 2, def_env, func_name->s);
+                return Expr(new Define(func_name->s, lambda, lexicalAddress(func_name->s, env)));
+            }
+            case E_DEFINE_MEMO: {
+                // (define-memoized (f x ...) body ...) binds f to a memoized lambda
+                if (stxs.size() < 3) {
+                    throw RuntimeError("Wrong number of arguments for define-memoized");
                 }
-                return Expr(new Define(func_name->s, Expr(new Lambda(params, Expr(new Begin(body_exprs))))));
+                List *func_def = dynamic_cast<List*>(stxs[1].get());
+                if (func_def == nullptr || func_def->stxs.empty()) {
+                    throw RuntimeError("Invalid define-memoized syntax");
+                }
+                SymbolSyntax *func_name = dynamic_cast<SymbolSyntax*>(func_def->stxs[0].get());
+                if (func_name == nullptr) {
+                    throw RuntimeError("Function name must be a symbol");
+                }
+                vector<string> params;
+                for (size_t i = 1; i < func_def->stxs.size(); ++i) {
+                    SymbolSyntax *param_sym = dynamic_cast<SymbolSyntax*>(func_def->stxs[i].get());
+                    if (param_sym == nullptr) {
+                        throw RuntimeError("Function parameter must be a symbol");
+                    }
+                    params.push_back(param_sym->s);
+                }
+                Assoc def_env = defineScope(func_name->s, env);
+                Expr lambda = parseLambda(params, stxs, 2, def_env, func_name->s);
+                return Expr(new Define(func_name->s, Expr(new Memoize({lambda})), lexicalAddress(func_name->s, env)));
             }
             case E_LET: {
                 if (stxs.size() < 3) {
@@ -368,12 +808,16 @@ Expr List::parse(Assoc &env) {
                         throw RuntimeError("let variable must be a symbol");
                     }
                     bindings.push_back(make_pair(var_sym->s, binding_pair->stxs[1].parse(env)));
+                    nameLambda(bindings.back().second, var_sym->s);
                 }
-                vector<Expr> body_exprs;
-                for (size_t i = 2; i < stxs.size(); ++i) {
-                    body_exprs.push_back(stxs[i].parse(env));
+                vector<string> vars;
+                for (const auto &binding : bindings) {
+                    vars.push_back(binding.first);
                 }
-                return Expr(new Let(bindings, Expr(new Begin(body_exprs))));
+                vector<string> locals;
+                Let *node = new Let(bindings, parseBody(stxs, 2, vars, env, locals));
+                node->locals = locals;
+                return Expr(node);
             }
             case E_LETREC: {
                 if (stxs.size() < 3) {
@@ -383,7 +827,7 @@ Expr List::parse(Assoc &env) {
                 if (bindings_list == nullptr) {
                     throw RuntimeError("letrec bindings must be a list");
                 }
-                vector<pair<string, Expr>> bindings;
+                vector<string> vars;
                 for (const auto &binding : bindings_list->stxs) {
                     List *binding_pair = dynamic_cast<List*>(binding.get());
                     if (binding_pair == nullptr || binding_pair->stxs.size() != 2) {
@@ -393,13 +837,112 @@ Expr List::parse(Assoc &env) {
                     if (var_sym == nullptr) {
                         throw RuntimeError("letrec variable must be a symbol");
                     }
-                    bindings.push_back(make_pair(var_sym->s, binding_pair->stxs[1].parse(env)));
+                    vars.push_back(var_sym->s);
+                }
+                Assoc rec_env = extendScope(vars, env, true);
+                vector<pair<string, Expr>> bindings;
+                for (size_t i = 0; i < vars.size(); ++i) {
+                    List *binding_pair = dynamic_cast<List*>(bindings_list->stxs[i].get());
+                    bindings.push_back(make_pair(vars[i], binding_pair->stxs[1].parse(rec_env)));
+                    nameLambda(bindings.back().second, vars[i]);
+                }
+                vector<string> locals;
+                Letrec *node = new Letrec(bindings, parseBody(stxs, 2, vars, env, locals));
+                node->locals = locals;
+                return Expr(node);
+            }
+            case E_LET_VALUES: {
+                // (let-values (((var ...) producer) ...) body ...)
+                if (stxs.size() < 3) {
+                    throw RuntimeError("Wrong number of arguments for let-values");
                 }
-                vector<Expr> body_exprs;
-                for (size_t i = 2; i < stxs.size(); ++i) {
-                    body_exprs.push_back(stxs[i].parse(env));
+                List *bindings_list = dynamic_cast<List*>(stxs[1].get());
+                if (bindings_list == nullptr) {
+                    throw RuntimeError("let-values bindings must be a list");
+                }
+                vector<pair<vector<string>, Expr>> bindings;
+                vector<string> vars;
+                for (const auto &binding : bindings_list->stxs) {
+                    List *binding_pair = dynamic_cast<List*>(binding.get());
+                    if (binding_pair == nullptr || binding_pair->stxs.size() != 2) {
+                        throw RuntimeError("let-values binding must be a pair");
+                    }
+                    List *formals = dynamic_cast<List*>(binding_pair->stxs[0].get());
+                    if (formals == nullptr) {
+                        throw RuntimeError("let-values formals must be a list");
+                    }
+                    vector<string> names;
+                    for (const auto &formal : formals->stxs) {
+                        SymbolSyntax *var_sym = dynamic_cast<SymbolSyntax*>(formal.get());
+                        if (var_sym == nullptr) {
+                            throw RuntimeError("let-values variable must be a symbol");
+                        }
+                        names.push_back(var_sym->s);
+                        vars.push_back(var_sym->s);
+                    }
+                    bindings.push_back(make_pair(names, binding_pair->stxs[1].parse(env)));
+                }
+                vector<string> locals;
+                LetValues *node = new LetValues(bindings, parseBody(stxs, 2, vars, env, locals));
+                node->locals = locals;
+                return Expr(node);
+            }
+            case E_DEFINE_RECORD: {
+                // (define-record-type <name> (ctor field ...) pred (field accessor [modifier]) ...)
+                if (stxs.size() < 4) {
+                    throw RuntimeError("Wrong number of arguments for define-record-type");
+                }
+                SymbolSyntax *type_sym = dynamic_cast<SymbolSyntax*>(stxs[1].get());
+                List *ctor_spec = dynamic_cast<List*>(stxs[2].get());
+                SymbolSyntax *pred_sym = dynamic_cast<SymbolSyntax*>(stxs[3].get());
+                if (type_sym == nullptr || ctor_spec == nullptr || ctor_spec->stxs.empty() || pred_sym == nullptr) {
+                    throw RuntimeError("Invalid define-record-type syntax");
+                }
+                vector<string> fields;
+                vector<pair<string, size_t>> accessors;
+                vector<pair<string, size_t>> modifiers;
+                for (size_t i = 4; i < stxs.size(); ++i) {
+                    List *field_spec = dynamic_cast<List*>(stxs[i].get());
+                    if (field_spec == nullptr || field_spec->stxs.size() < 2 || field_spec->stxs.size() > 3) {
+                        throw RuntimeError("record field must be (field accessor [modifier])");
+                    }
+                    vector<string> names;
+                    for (const auto &name : field_spec->stxs) {
+                        SymbolSyntax *name_sym = dynamic_cast<SymbolSyntax*>(name.get());
+                        if (name_sym == nullptr) {
+                            throw RuntimeError("record field and procedure names must be symbols");
+                        }
+                        names.push_back(name_sym->s);
+                    }
+                    for (const auto &field : fields) {
+                        if (field == names[0]) {
+                            throw RuntimeError("Duplicate record field: " + field);
+                        }
+                    }
+                    accessors.push_back(mp(names[1], fields.size()));
+                    if (names.size() == 3) {
+                        modifiers.push_back(mp(names[2], fields.size()));
+                    }
+                    fields.push_back(names[0]);
+                }
+                SymbolSyntax *ctor_sym = dynamic_cast<SymbolSyntax*>(ctor_spec->stxs[0].get());
+                if (ctor_sym == nullptr) {
+                    throw RuntimeError("record constructor name must be a symbol");
+                }
+                vector<size_t> ctor_slots;
+                for (size_t i = 1; i < ctor_spec->stxs.size(); ++i) {
+                    SymbolSyntax *arg_sym = dynamic_cast<SymbolSyntax*>(ctor_spec->stxs[i].get());
+                    size_t slot = 0;
+                    while (arg_sym != nullptr && slot < fields.size() && fields[slot] != arg_sym->s) {
+                        ++slot;
+                    }
+                    if (arg_sym == nullptr || slot == fields.size()) {
+                        throw RuntimeError("record constructor argument must be a declared field");
+                    }
+                    ctor_slots.push_back(slot);
                 }
-                return Expr(new Letrec(bindings, Expr(new Begin(body_exprs))));
+                return Expr(new DefineRecordType(type_sym->s, fields, ctor_sym->s, ctor_slots,
+                                                 pred_sym->s, accessors, modifiers));
             }
             case E_SET: {
                 if (stxs.size() != 3) {
@@ -409,7 +952,8 @@ Expr List::parse(Assoc &env) {
                 if (var_sym == nullptr) {
                     throw RuntimeError("set! variable must be a symbol");
                 }
-                return Expr(new Set(var_sym->s, stxs[2].parse(env)));
+                noteReference(var_sym->s, env);
+                return Expr(new Set(var_sym->s, stxs[2].parse(env), lexicalAddress(var_sym->s, env)));
             }
             default:
                 throw RuntimeError("Unknown reserved word: " + op);
@@ -0,0 +1,229 @@
+/**
+ * @file profile.cpp
+ * @brief Implementation of the per-procedure profiler and its reports
+ */
+
+#include "profile.hpp"
+#include "heap.hpp"
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <iomanip>
+#include <chrono>
+#include <cstring>
+#include <sys/time.h>
+
+bool profile_enabled = false;
+bool sample_profile_enabled = false;
+const std::string *sample_stack[SAMPLE_STACK_DEPTH];
+volatile std::sig_atomic_t sample_depth = 0;
+
+namespace {
+
+struct ProfileEntry {
+    std::shared_ptr<const std::string> name;  ///< Keeps the key pointer valid
+    unsigned long long calls;
+    unsigned long long inclusive_ns;
+    unsigned long long exclusive_ns;
+    unsigned long long allocations;           ///< Made by the body itself
+    int depth;                                ///< Active activations of this name
+};
+
+// Node of the call-path tree; node 0 is the root above top-level calls
+struct CallNode {
+    const std::string *name;
+    size_t parent;
+    std::map<const std::string*, size_t> children;
+    unsigned long long self_ns;
+};
+
+struct Frame {
+    ProfileEntry *entry;
+    size_t node;
+    unsigned long long start_ns;
+    unsigned long long child_ns;
+    unsigned long long start_allocs;
+    unsigned long long child_allocs;
+};
+
+const int SAMPLE_SLOTS = 4096;          ///< Distinct stacks; power of two
+const int SAMPLE_PROBES = 32;
+
+// One distinct sampled stack, root first. Filled only by the signal handler.
+struct Sample {
+    unsigned long long count;
+    unsigned long long hash;
+    int depth;
+    const std::string *frames[SAMPLE_STACK_DEPTH];
+};
+
+Sample samples[SAMPLE_SLOTS];
+unsigned long long dropped_samples = 0;   ///< Samples that found no free slot
+
+std::map<const std::string*, ProfileEntry> entries;
+std::vector<CallNode> call_tree(1, CallNode{nullptr, 0, {}, 0});
+std::vector<Frame> frames;
+
+unsigned long long nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+void profileEnter(const std::shared_ptr<const std::string> &name) {
+    ProfileEntry &entry = entries[name.get()];
+    if (!entry.name) {
+        entry.name = name;
+    }
+    entry.calls++;
+    entry.depth++;
+    size_t parent = frames.empty() ? 0 : frames.back().node;
+    auto it = call_tree[parent].children.find(name.get());
+    size_t node;
+    if (it != call_tree[parent].children.end()) {
+        node = it->second;
+    } else {
+        node = call_tree.size();
+        call_tree.push_back(CallNode{name.get(), parent, {}, 0});
+        call_tree[parent].children[name.get()] = node;
+    }
+    frames.push_back(Frame{&entry, node, nowNs(), 0, heap_stats.allocations, 0});
+}
+
+void profileLeave() {
+    Frame frame = frames.back();
+    frames.pop_back();
+    unsigned long long elapsed = nowNs() - frame.start_ns;
+    unsigned long long self_ns = elapsed - std::min(elapsed, frame.child_ns);
+    unsigned long long allocs = heap_stats.allocations - frame.start_allocs;
+    ProfileEntry &entry = *frame.entry;
+    entry.exclusive_ns += self_ns;
+    entry.allocations += allocs - frame.child_allocs;
+    if (--entry.depth == 0) {
+        entry.inclusive_ns += elapsed;
+    }
+    call_tree[frame.node].self_ns += self_ns;
+    if (!frames.empty()) {
+        frames.back().child_ns += elapsed;
+        frames.back().child_allocs += allocs;
+    }
+}
+
+void printProfile(std::ostream &os) {
+    std::vector<const ProfileEntry*> sorted;
+    for (const auto &kv : entries) {
+        sorted.push_back(&kv.second);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const ProfileEntry *a, const ProfileEntry *b) {
+        if (a->exclusive_ns != b->exclusive_ns) return a->exclusive_ns > b->exclusive_ns;
+        return *a->name < *b->name;
+    });
+    os << std::left << std::setw(24) << "procedure" << std::right
+       << std::setw(12) << "calls" << std::setw(14) << "incl ms"
+       << std::setw(14) << "excl ms" << std::setw(12) << "allocs" << "\n";
+    os << std::fixed << std::setprecision(3);
+    for (const ProfileEntry *entry : sorted) {
+        os << std::left << std::setw(24) << *entry->name << std::right
+           << std::setw(12) << entry->calls
+           << std::setw(14) << entry->inclusive_ns / 1e6
+           << std::setw(14) << entry->exclusive_ns / 1e6
+           << std::setw(12) << entry->allocations << "\n";
+    }
+    os.unsetf(std::ios::floatfield);
+}
+
+/**
+ * @brief Writes one "caller;callee <self ns>" line per call path
+ */
+void writeProfileFolded(std::ostream &os) {
+    for (size_t i = 1; i < call_tree.size(); ++i) {
+        if (call_tree[i].self_ns == 0) continue;
+        std::vector<const std::string*> path;
+        for (size_t n = i; n != 0; n = call_tree[n].parent) {
+            path.push_back(call_tree[n].name);
+        }
+        for (size_t j = path.size(); j-- > 0;) {
+            os << *path[j] << (j == 0 ? " " : ";");
+        }
+        os << call_tree[i].self_ns << "\n";
+    }
+}
+
+namespace {
+
+void sampleHandler(int) {
+    int depth = sample_depth;
+    std::atomic_signal_fence(std::memory_order_acquire);
+    if (depth > SAMPLE_STACK_DEPTH) depth = SAMPLE_STACK_DEPTH;
+    unsigned long long hash = 1469598103934665603ULL;
+    for (int i = 0; i < depth; ++i) {
+        hash = (hash ^ reinterpret_cast<unsigned long long>(sample_stack[i])) * 1099511628211ULL;
+    }
+    hash = (hash ^ static_cast<unsigned long long>(depth)) * 1099511628211ULL;
+    for (int probe = 0; probe < SAMPLE_PROBES; ++probe) {
+        Sample &slot = samples[(hash + probe) & (SAMPLE_SLOTS - 1)];
+        if (slot.count == 0) {
+            slot.hash = hash;
+            slot.depth = depth;
+            std::memcpy(slot.frames, sample_stack, depth * sizeof(sample_stack[0]));
+            slot.count = 1;
+            return;
+        }
+        if (slot.hash == hash && slot.depth == depth &&
+            std::memcmp(slot.frames, sample_stack, depth * sizeof(sample_stack[0])) == 0) {
+            slot.count++;
+            return;
+        }
+    }
+    dropped_samples++;
+}
+
+} // namespace
+
+/**
+ * @brief Installs the SIGPROF handler and arms the CPU-time interval timer
+ */
+bool startSampleProfile(long interval_us) {
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_handler = sampleHandler;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGPROF, &action, nullptr) != 0) return false;
+    struct itimerval timer;
+    timer.it_interval.tv_sec = interval_us / 1000000;
+    timer.it_interval.tv_usec = interval_us % 1000000;
+    timer.it_value = timer.it_interval;
+    if (setitimer(ITIMER_PROF, &timer, nullptr) != 0) return false;
+    sample_profile_enabled = true;
+    return true;
+}
+
+void stopSampleProfile() {
+    struct itimerval timer;
+    std::memset(&timer, 0, sizeof(timer));
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    signal(SIGPROF, SIG_IGN);
+    sample_profile_enabled = false;
+}
+
+/**
+ * @brief Writes one "caller;callee <samples>" line per distinct sampled stack
+ */
+void writeSampleProfile(std::ostream &os) {
+    for (int i = 0; i < SAMPLE_SLOTS; ++i) {
+        const Sample &slot = samples[i];
+        if (slot.count == 0) continue;
+        if (slot.depth == 0) {
+            os << "<toplevel>";
+        }
+        for (int j = 0; j < slot.depth; ++j) {
+            os << (j == 0 ? "" : ";") << *slot.frames[j];
+        }
+        os << " " << slot.count << "\n";
+    }
+    if (dropped_samples != 0) {
+        os << "<dropped> " << dropped_samples << "\n";
+    }
+}
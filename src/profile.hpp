@@ -0,0 +1,81 @@
+#ifndef PROFILE_HPP
+#define PROFILE_HPP
+
+/**
+ * @file profile.hpp
+ * @brief Deterministic per-procedure profiler (--profile)
+ *
+ * Every closure call opens a ProfileScope keyed by the name of the lambda
+ * that created the closure: its define-name, its let-binding name, or
+ * "lambda@<line>" for anonymous lambdas. Per name the profiler counts calls,
+ * inclusive time (counted once per outermost activation, so recursion is not
+ * double counted), exclusive time and allocations made by the body itself.
+ * It also builds a call-path tree for collapsed-stack ("folded") output that
+ * flame graph tools consume.
+ *
+ * The sampling mode (--sample-profile) avoids the timing distortion of the
+ * above on call-heavy code. Calls only push and pop a name pointer on a
+ * fixed shadow stack; a SIGPROF timer handler copies that stack into a
+ * fixed-size table without allocating, and the table is written as folded
+ * stacks at exit.
+ */
+
+#include <memory>
+#include <string>
+#include <ostream>
+#include <atomic>
+#include <csignal>
+
+extern bool profile_enabled;
+
+const int SAMPLE_STACK_DEPTH = 128;    ///< Frames kept per sample; deeper ones are cut
+
+extern bool sample_profile_enabled;
+extern const std::string *sample_stack[SAMPLE_STACK_DEPTH];
+extern volatile std::sig_atomic_t sample_depth;
+
+void profileEnter(const std::shared_ptr<const std::string> &);
+void profileLeave();
+void printProfile(std::ostream &);
+void writeProfileFolded(std::ostream &);
+bool startSampleProfile(long);
+void stopSampleProfile();
+void writeSampleProfile(std::ostream &);
+
+/**
+ * @brief RAII probe around one procedure activation; no-op when disabled
+ */
+class ProfileScope {
+    bool active;
+public:
+    explicit ProfileScope(const std::shared_ptr<const std::string> &name)
+        : active(profile_enabled && name) {
+        if (active) profileEnter(name);
+    }
+    ~ProfileScope() {
+        if (active) profileLeave();
+    }
+};
+
+/**
+ * @brief Shadow stack entry read by the SIGPROF handler; no-op when disabled
+ */
+class SampleFrame {
+    bool active;
+public:
+    explicit SampleFrame(const std::string *name) : active(sample_profile_enabled) {
+        if (!active) return;
+        int depth = sample_depth;
+        if (depth < SAMPLE_STACK_DEPTH) {
+            sample_stack[depth] = name;
+        }
+        // The slot must be written before the handler can see it
+        std::atomic_signal_fence(std::memory_order_release);
+        sample_depth = depth + 1;
+    }
+    ~SampleFrame() {
+        if (active) sample_depth = sample_depth - 1;
+    }
+};
+
+#endif // PROFILE_HPP
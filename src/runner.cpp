@@ -0,0 +1,287 @@
+/**
+ * @file runner.cpp
+ * @brief Implementation of the in-process score corpus runner
+ */
+
+#include "runner.hpp"
+#include "heap.hpp"
+#include "fuel.hpp"
+#include "RE.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <dirent.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Defined in main.cpp
+void REPL(std::istream &, const std::string &);
+
+namespace {
+
+const size_t MAX_REPORT = 512;    ///< Bytes of mismatch detail sent back by a worker
+
+struct TestCase {
+    std::string name;
+    std::string input_path;
+    std::string output_path;     ///< Empty when there is no expected output
+};
+
+struct TestResult {
+    enum Status { PASS, FAIL, SKIP, CRASH } status;
+    double ms;
+    size_t peak_bytes;
+    std::string detail;          ///< First mismatching line, or the crash reason
+};
+
+bool readFile(const std::string &path, std::string &text) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    text = contents.str();
+    return true;
+}
+
+// Numeric names sort by value, so 2.in runs before 10.in
+bool caseOrder(const TestCase &a, const TestCase &b) {
+    char *end_a = nullptr, *end_b = nullptr;
+    long na = std::strtol(a.name.c_str(), &end_a, 10);
+    long nb = std::strtol(b.name.c_str(), &end_b, 10);
+    bool numeric_a = *end_a == '\0' && !a.name.empty();
+    bool numeric_b = *end_b == '\0' && !b.name.empty();
+    if (numeric_a && numeric_b) return na < nb;
+    if (numeric_a != numeric_b) return numeric_a;
+    return a.name < b.name;
+}
+
+bool listCases(const std::string &dir, std::vector<TestCase> &cases) {
+    DIR *handle = opendir(dir.c_str());
+    if (handle == nullptr) return false;
+    while (dirent *entry = readdir(handle)) {
+        std::string file = entry->d_name;
+        if (file.size() <= 3 || file.compare(file.size() - 3, 3, ".in") != 0) continue;
+        TestCase test;
+        test.name = file.substr(0, file.size() - 3);
+        test.input_path = dir + "/" + file;
+        std::string expected = dir + "/" + test.name + ".out";
+        if (std::ifstream(expected)) test.output_path = expected;
+        cases.push_back(test);
+    }
+    closedir(handle);
+    std::sort(cases.begin(), cases.end(), caseOrder);
+    return true;
+}
+
+/**
+ * @brief Lines of a transcript as score.sh compares them
+ *
+ * Drops the trailing prompt left by (exit), removes the first "scm> " of
+ * each line, then applies diff -b: runs of blanks become one space and
+ * trailing blanks are ignored.
+ */
+std::vector<std::string> normalizedLines(std::string text, bool transcript) {
+    const std::string prompt = "scm> ";
+    if (transcript && text.size() >= prompt.size() &&
+        text.compare(text.size() - prompt.size(), prompt.size(), prompt) == 0) {
+        text.erase(text.size() - prompt.size());
+    }
+    std::vector<std::string> lines;
+    std::istringstream in(text);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (transcript) {
+            size_t at = line.find(prompt);
+            if (at != std::string::npos) line.erase(at, prompt.size());
+        }
+        std::string squeezed;
+        bool blank = false;
+        for (char c : line) {
+            if (c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f') {
+                blank = true;
+                continue;
+            }
+            if (blank) squeezed.push_back(' ');
+            blank = false;
+            squeezed.push_back(c);
+        }
+        lines.push_back(squeezed);
+    }
+    return lines;
+}
+
+TestResult runCase(const TestCase &test, long long step_limit, long long timeout_ms) {
+    TestResult result = {TestResult::PASS, 0.0, 0, ""};
+    std::string source;
+    if (!readFile(test.input_path, source)) {
+        result.status = TestResult::CRASH;
+        result.detail = "cannot read " + test.input_path;
+        return result;
+    }
+    std::istringstream input(source + "\n(exit)\n");
+    std::ostringstream output;
+    std::streambuf *saved = std::cout.rdbuf(output.rdbuf());
+    size_t baseline = heap_stats.live_bytes;
+    heap_stats.peak_bytes = baseline;
+    setStepLimit(step_limit);
+    if (timeout_ms > 0 && !armWatchdog(timeout_ms)) {
+        std::cout.rdbuf(saved);
+        result.status = TestResult::CRASH;
+        result.detail = "cannot start the --timeout-ms watchdog";
+        return result;
+    }
+    auto start = std::chrono::steady_clock::now();
+    try {
+        REPL(input, "");
+    } catch (const RuntimeError &e) {
+        // Private inheritance hides it from the std::exception handler
+        result.status = TestResult::CRASH;
+        result.detail = e.message();
+    } catch (const std::exception &e) {
+        result.status = TestResult::CRASH;
+        result.detail = e.what();
+    }
+    auto end = std::chrono::steady_clock::now();
+    if (timeout_ms > 0) disarmWatchdog();
+    std::cout.rdbuf(saved);
+    result.ms = std::chrono::duration<double, std::milli>(end - start).count();
+    result.peak_bytes = heap_stats.peak_bytes - baseline;
+    if (result.status == TestResult::CRASH) return result;
+
+    std::string expected_text;
+    if (test.output_path.empty() || !readFile(test.output_path, expected_text)) {
+        result.status = TestResult::SKIP;
+        return result;
+    }
+    std::vector<std::string> actual = normalizedLines(output.str(), true);
+    std::vector<std::string> expected = normalizedLines(expected_text, false);
+    size_t n = std::max(actual.size(), expected.size());
+    for (size_t i = 0; i < n; ++i) {
+        const char *got = i < actual.size() ? actual[i].c_str() : "<end of output>";
+        const char *want = i < expected.size() ? expected[i].c_str() : "<end of output>";
+        if (i < actual.size() && i < expected.size() && actual[i] == expected[i]) continue;
+        result.status = TestResult::FAIL;
+        result.detail = "line " + std::to_string(i + 1) + ": expected \"" + want + "\", got \"" + got + "\"";
+        if (result.detail.size() > MAX_REPORT) result.detail.resize(MAX_REPORT);
+        break;
+    }
+    return result;
+}
+
+/**
+ * @brief Runs the cases in forked workers, at most jobs at a time
+ *
+ * Each worker writes its result as "status ms peak detail" to a pipe. The
+ * record is far below PIPE_BUF, so the worker never blocks on the write.
+ */
+void runForked(const std::vector<TestCase> &cases, int jobs, long long step_limit, long long timeout_ms,
+               std::vector<TestResult> &results) {
+    std::map<pid_t, std::pair<size_t, int>> running;   // pid -> case, read end
+    size_t next = 0;
+    std::cout.flush();
+    while (next < cases.size() || !running.empty()) {
+        while (next < cases.size() && static_cast<int>(running.size()) < jobs) {
+            int fds[2];
+            pid_t pid = -1;
+            if (pipe(fds) == 0) {
+                pid = fork();
+                if (pid < 0) {
+                    close(fds[0]);
+                    close(fds[1]);
+                }
+            }
+            if (pid < 0) {
+                // No worker available: run this case here instead
+                results[next] = runCase(cases[next], step_limit, timeout_ms);
+                ++next;
+                continue;
+            }
+            if (pid == 0) {
+                close(fds[0]);
+                TestResult result = runCase(cases[next], step_limit, timeout_ms);
+                std::string record = std::to_string(static_cast<int>(result.status)) + " " +
+                                     std::to_string(result.ms) + " " +
+                                     std::to_string(result.peak_bytes) + " " + result.detail;
+                ssize_t written = write(fds[1], record.data(), record.size());
+                (void)written;
+                _exit(0);
+            }
+            close(fds[1]);
+            running[pid] = std::make_pair(next, fds[0]);
+            ++next;
+        }
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, 0);
+        auto it = running.find(pid);
+        if (it == running.end()) continue;
+        size_t index = it->second.first;
+        int fd = it->second.second;
+        running.erase(it);
+        std::string record;
+        char buffer[1024];
+        ssize_t n;
+        while ((n = read(fd, buffer, sizeof(buffer))) > 0) record.append(buffer, n);
+        close(fd);
+        TestResult &result = results[index];
+        std::istringstream fields(record);
+        int code = 0;
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0 &&
+            fields >> code >> result.ms >> result.peak_bytes) {
+            result.status = static_cast<TestResult::Status>(code);
+            fields.get();
+            std::getline(fields, result.detail, '\0');
+        } else {
+            result.status = TestResult::CRASH;
+            result.detail = WIFSIGNALED(status) ? std::string("killed by ") + strsignal(WTERMSIG(status))
+                                                : "worker failed";
+        }
+    }
+}
+
+} // namespace
+
+/**
+ * @brief Runs a score directory and prints one line per case plus a summary
+ *
+ * @return Process exit status: 0 when no case failed or crashed
+ */
+int runTests(const std::string &dir, int jobs, long long step_limit, long long timeout_ms) {
+    std::vector<TestCase> cases;
+    if (!listCases(dir, cases)) {
+        std::cerr << "cannot open test directory: " << dir << std::endl;
+        return 1;
+    }
+    std::vector<TestResult> results(cases.size());
+    auto start = std::chrono::steady_clock::now();
+    if (jobs <= 1) {
+        for (size_t i = 0; i < cases.size(); ++i) {
+            results[i] = runCase(cases[i], step_limit, timeout_ms);
+        }
+    } else {
+        runForked(cases, jobs, step_limit, timeout_ms, results);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    static const char *labels[] = {"PASS", "FAIL", "SKIP", "CRASH"};
+    int counts[4] = {0, 0, 0, 0};
+    for (size_t i = 0; i < cases.size(); ++i) {
+        const TestResult &result = results[i];
+        counts[result.status]++;
+        char line[256];
+        std::snprintf(line, sizeof(line), "%-5s %-24s %9.2f ms %10zu bytes",
+                      labels[result.status], cases[i].input_path.c_str(), result.ms, result.peak_bytes);
+        std::cout << line;
+        if (!result.detail.empty()) std::cout << "  " << result.detail;
+        std::cout << '\n';
+    }
+    std::cout << counts[TestResult::PASS] << " passed, " << counts[TestResult::FAIL] << " failed, "
+              << counts[TestResult::CRASH] << " crashed, " << counts[TestResult::SKIP] << " skipped in "
+              << std::chrono::duration<double, std::milli>(end - start).count() << " ms" << std::endl;
+    return counts[TestResult::FAIL] + counts[TestResult::CRASH] == 0 ? 0 : 1;
+}
@@ -0,0 +1,26 @@
+#ifndef RUNNER_HPP
+#define RUNNER_HPP
+
+/**
+ * @file runner.hpp
+ * @brief In-process runner for the score corpus (--run-tests)
+ *
+ * Runs every <name>.in of a directory through a fresh REPL, captures its
+ * output in memory and compares it with <name>.out the way score.sh does:
+ * prompts stripped and whitespace compared like diff -b. Cases without a
+ * .out file are run but reported as skipped.
+ *
+ * With one job the cases run one after another in this process. Each case
+ * gets a fresh global environment, and the REPL resets the evaluator's
+ * session state (parse cache, rebound library procedures, line numbers)
+ * when it ends, so a case sees what a fresh process would. That state is
+ * not thread-safe, so parallel runs fork one worker per case instead;
+ * a worker that crashes only fails its own case. The --max-steps and
+ * --timeout-ms limits apply to each case on its own.
+ */
+
+#include <string>
+
+int runTests(const std::string &, int, long long, long long);
+
+#endif // RUNNER_HPP
@@ -0,0 +1,264 @@
+/**
+ * @file snapshot.cpp
+ * @brief Heap graph walk, dominator tree and JSON output for heap snapshots
+ */
+
+#include "snapshot.hpp"
+#include "heap.hpp"
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+
+Assoc *snapshot_root = nullptr;
+
+namespace {
+
+struct HeapNode {
+    const ValueBase *value;     ///< Null for frames and the root
+    const AssocList *frame;     ///< Null for values and the root
+    size_t size;
+    std::vector<int> edges;
+};
+
+// Assigns node ids in discovery order; node 0 is the synthetic root
+class HeapGraph {
+public:
+    std::vector<HeapNode> nodes;
+
+    explicit HeapGraph(const Assoc &env) {
+        nodes.push_back(HeapNode{nullptr, nullptr, 0, {}});
+        std::vector<int> pending;
+        if (env.get() != nullptr) {
+            int head = frameNode(env.get(), pending);
+            nodes[0].edges.push_back(head);
+        }
+        while (!pending.empty()) {
+            int id = pending.back();
+            pending.pop_back();
+            std::vector<int> edges;
+            if (nodes[id].frame != nullptr) {
+                const AssocList *frame = nodes[id].frame;
+                if (frame->v.get() != nullptr) edges.push_back(valueNode(frame->v.get(), pending));
+                if (frame->next.get() != nullptr) edges.push_back(frameNode(frame->next.get(), pending));
+            } else {
+                addValueEdges(nodes[id].value, edges, pending);
+            }
+            nodes[id].edges = edges;
+        }
+    }
+
+    int idOf(const void *object) const {
+        return ids.at(object);
+    }
+
+private:
+    std::unordered_map<const void*, int> ids;
+
+    int frameNode(const AssocList *frame, std::vector<int> &pending) {
+        auto it = ids.find(frame);
+        if (it != ids.end()) return it->second;
+        int id = nodes.size();
+        ids[frame] = id;
+        nodes.push_back(HeapNode{nullptr, frame, sizeof(AssocList) + frame->x.capacity(), {}});
+        pending.push_back(id);
+        return id;
+    }
+
+    int valueNode(const ValueBase *value, std::vector<int> &pending) {
+        auto it = ids.find(value);
+        if (it != ids.end()) return it->second;
+        int id = nodes.size();
+        ids[value] = id;
+        nodes.push_back(HeapNode{value, nullptr, valueSize(value), {}});
+        pending.push_back(id);
+        return id;
+    }
+
+    void addValueEdges(const ValueBase *value, std::vector<int> &edges, std::vector<int> &pending) {
+        if (value->v_type == V_PAIR) {
+            const Pair *pair = static_cast<const Pair*>(value);
+            edges.push_back(valueNode(pair->car.get(), pending));
+            edges.push_back(valueNode(pair->cdr.get(), pending));
+        } else if (value->v_type == V_RECORD) {
+            const Record *record = static_cast<const Record*>(value);
+            for (size_t i = 0; i < record->size(); ++i) {
+                edges.push_back(valueNode(record->slots()[i].get(), pending));
+            }
+        } else if (value->v_type == V_VALUES) {
+            for (const Value &item : static_cast<const MultipleValues*>(value)->values) {
+                edges.push_back(valueNode(item.get(), pending));
+            }
+        } else if (value->v_type == V_PROC) {
+            const Procedure *proc = static_cast<const Procedure*>(value);
+            if (proc->env.get() != nullptr) edges.push_back(frameNode(proc->env.get(), pending));
+            if (proc->memo) {
+                for (const auto &entry : proc->memo->entries) {
+                    for (const Value &arg : entry.first) edges.push_back(valueNode(arg.get(), pending));
+                    edges.push_back(valueNode(entry.second.get(), pending));
+                }
+            }
+        }
+    }
+
+    static size_t valueSize(const ValueBase *value) {
+        switch (value->v_type) {
+            case V_INT: return sizeof(Integer);
+            case V_RATIONAL: return sizeof(Rational);
+            case V_REAL: return sizeof(Real);
+            case V_BOOL: return sizeof(Boolean);
+            case V_SYM: return sizeof(Symbol) + static_cast<const Symbol*>(value)->s.capacity();
+            case V_NULL: return sizeof(Null);
+            case V_STRING: return sizeof(String) + static_cast<const String*>(value)->str().capacity();
+            case V_PAIR: return sizeof(Pair);
+            case V_PROC: return sizeof(Procedure);
+            case V_PRIMITIVE: return sizeof(Primitive);
+            case V_VALUES: return sizeof(MultipleValues) + static_cast<const MultipleValues*>(value)->values.capacity() * sizeof(Value);
+            case V_ENVIRONMENT: return sizeof(Environment);
+            case V_RECORD: return sizeof(Record) + static_cast<const Record*>(value)->size() * sizeof(Value);
+            case V_VOID: return sizeof(Void);
+            case V_TERMINATE: return sizeof(Terminate);
+            default: return sizeof(ValueBase);
+        }
+    }
+};
+
+/**
+ * @brief Immediate dominators by the Cooper-Harvey-Kennedy iteration
+ *
+ * Fills order with the nodes in reverse postorder, which lists every node
+ * after its immediate dominator.
+ */
+std::vector<int> dominators(const HeapGraph &graph, std::vector<int> &order) {
+    size_t n = graph.nodes.size();
+    std::vector<int> postorder_index(n, -1);
+    std::vector<std::pair<int, size_t>> stack;
+    std::vector<bool> visited(n, false);
+    stack.push_back(std::make_pair(0, 0));
+    visited[0] = true;
+    order.clear();
+    while (!stack.empty()) {
+        int node = stack.back().first;
+        size_t &next = stack.back().second;
+        if (next < graph.nodes[node].edges.size()) {
+            int target = graph.nodes[node].edges[next++];
+            if (!visited[target]) {
+                visited[target] = true;
+                stack.push_back(std::make_pair(target, 0));
+            }
+        } else {
+            postorder_index[node] = order.size();
+            order.push_back(node);
+            stack.pop_back();
+        }
+    }
+    std::reverse(order.begin(), order.end());
+
+    std::vector<std::vector<int>> predecessors(n);
+    for (size_t i = 0; i < n; ++i) {
+        for (int target : graph.nodes[i].edges) predecessors[target].push_back(i);
+    }
+    std::vector<int> idom(n, -1);
+    idom[0] = 0;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t k = 1; k < order.size(); ++k) {
+            int node = order[k];
+            int candidate = -1;
+            for (int pred : predecessors[node]) {
+                if (idom[pred] == -1) continue;
+                if (candidate == -1) {
+                    candidate = pred;
+                    continue;
+                }
+                int a = pred, b = candidate;
+                while (a != b) {
+                    while (postorder_index[a] < postorder_index[b]) a = idom[a];
+                    while (postorder_index[b] < postorder_index[a]) b = idom[b];
+                }
+                candidate = a;
+            }
+            if (idom[node] != candidate) {
+                idom[node] = candidate;
+                changed = true;
+            }
+        }
+    }
+    return idom;
+}
+
+void writeJsonString(std::ostream &os, const std::string &s) {
+    os << '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            os << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            os << escaped;
+        } else {
+            os << c;
+        }
+    }
+    os << '"';
+}
+
+} // namespace
+
+void writeHeapSnapshot(std::ostream &os, const Assoc &env) {
+    HeapGraph graph(env);
+    std::vector<int> order;
+    std::vector<int> idom = dominators(graph, order);
+    std::vector<size_t> retained(graph.nodes.size(), 0);
+    for (size_t k = order.size(); k-- > 0;) {
+        int node = order[k];
+        retained[node] += graph.nodes[node].size;
+        if (node != 0) retained[idom[node]] += retained[node];
+    }
+
+    os << "{\"nodes\":[";
+    for (size_t i = 0; i < graph.nodes.size(); ++i) {
+        const HeapNode &node = graph.nodes[i];
+        os << (i == 0 ? "\n" : ",\n") << "{\"id\":" << i << ",\"type\":";
+        if (node.frame != nullptr) {
+            os << "\"environment\",\"name\":";
+            writeJsonString(os, node.frame->x);
+        } else if (node.value != nullptr) {
+            os << '"' << heapCategoryName(node.value->v_type) << '"';
+            if (node.value->v_type == V_PROC) {
+                const Procedure *proc = static_cast<const Procedure*>(node.value);
+                os << ",\"name\":";
+                writeJsonString(os, *proc->code->name);
+            }
+        } else {
+            os << "\"root\"";
+        }
+        os << ",\"size\":" << node.size << ",\"retained\":" << retained[i]
+           << ",\"dominator\":" << idom[i] << ",\"edges\":[";
+        for (size_t j = 0; j < node.edges.size(); ++j) {
+            os << (j == 0 ? "" : ",") << node.edges[j];
+        }
+        os << "]}";
+    }
+
+    // Global bindings, charged with what their value alone keeps alive
+    std::vector<std::pair<size_t, int>> bindings;
+    for (const AssocList *frame = env.get(); frame != nullptr; frame = frame->next.get()) {
+        if (frame->v.get() == nullptr) continue;
+        int owner = graph.idOf(frame);
+        int value = graph.idOf(frame->v.get());
+        bindings.push_back(std::make_pair(idom[value] == owner ? retained[value] : 0, owner));
+    }
+    std::stable_sort(bindings.begin(), bindings.end(),
+                     [](const std::pair<size_t, int> &a, const std::pair<size_t, int> &b) {
+                         return a.first > b.first;
+                     });
+    os << "\n],\"bindings\":[";
+    for (size_t k = 0; k < bindings.size(); ++k) {
+        os << (k == 0 ? "\n" : ",\n") << "{\"name\":";
+        writeJsonString(os, graph.nodes[bindings[k].second].frame->x);
+        os << ",\"node\":" << bindings[k].second << ",\"retained\":" << bindings[k].first << "}";
+    }
+    os << "\n]}\n";
+}
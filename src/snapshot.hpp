@@ -0,0 +1,23 @@
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+/**
+ * @file snapshot.hpp
+ * @brief Heap snapshots of everything reachable from the global environment
+ *
+ * A snapshot is a JSON graph with one node per environment frame and per
+ * value, each carrying its type, its own size, its outgoing edges, its
+ * immediate dominator and its retained size (the bytes that would be freed
+ * if it were unreachable). A closing "bindings" table lists the global
+ * bindings by the retained size of their values, which is usually the
+ * question being asked: which forgotten name pins the memory.
+ */
+
+#include "value.hpp"
+#include <ostream>
+
+extern Assoc *snapshot_root;   ///< Global environment of the running REPL
+
+void writeHeapSnapshot(std::ostream &, const Assoc &);
+
+#endif // SNAPSHOT_HPP
@@ -0,0 +1,122 @@
+/**
+ * @file stats.cpp
+ * @brief Implementation of evaluation counters and their reports
+ */
+
+#include "stats.hpp"
+#include <map>
+#include <string>
+#include <iomanip>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+extern std::map<std::string, ExprType> primitives;
+extern std::map<std::string, ExprType> reserved_words;
+extern std::map<std::string, ExprType> library_syntax;
+extern std::map<std::string, ExprType> library_procedures;
+
+bool eval_stats_enabled = false;
+EvalStats eval_stats = {};
+
+unsigned long long readCycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+void recordEvalSample(ExprType type, unsigned long long cycles) {
+    int bucket = 0;
+    while (bucket + 1 < EVAL_STATS_BUCKETS && (cycles >> (bucket + 1)) != 0) {
+        ++bucket;
+    }
+    eval_stats.samples[type]++;
+    eval_stats.cycles[type] += cycles;
+    eval_stats.histogram[type][bucket]++;
+}
+
+/**
+ * @brief Human-readable name of an expression type
+ *
+ * Primitives and special forms are named after their Scheme keyword; the
+ * remaining node kinds get a descriptive name.
+ */
+const char *exprTypeName(ExprType type) {
+    static std::map<ExprType, std::string> names;
+    if (names.empty()) {
+        for (const auto &entry : primitives) names[entry.second] = entry.first;
+        for (const auto &entry : library_procedures) names[entry.second] = entry.first;
+        for (const auto &entry : reserved_words) names[entry.second] = entry.first;
+        for (const auto &entry : library_syntax) names[entry.second] = entry.first;
+        names[E_FIXNUM] = "<fixnum>";
+        names[E_RATIONAL] = "<rational>";
+        names[E_REAL] = "<real>";
+        names[E_STRING] = "<string>";
+        names[E_TRUE] = "#t";
+        names[E_FALSE] = "#f";
+        names[E_VAR] = "<variable>";
+        names[E_APPLY] = "<application>";
+        names[E_LIBRARY_CALL] = "<library-call>";
+        names[E_RECORD_CONSTRUCT] = "<record-constructor>";
+        names[E_RECORD_PREDICATE] = "<record-predicate>";
+        names[E_RECORD_ACCESS] = "<record-accessor>";
+        names[E_RECORD_MODIFY] = "<record-modifier>";
+    }
+    auto it = names.find(type);
+    return it == names.end() ? "<unknown>" : it->second.c_str();
+}
+
+void printEvalStats(std::ostream &os) {
+    unsigned long long total = 0;
+    for (int t = 0; t < EXPR_TYPE_SLOTS; ++t) total += eval_stats.count[t];
+    os << std::left << std::setw(18) << "expression" << std::right
+       << std::setw(14) << "evaluations" << std::setw(8) << "share"
+       << std::setw(14) << "mean cycles" << '\n';
+    for (int t = 0; t < EXPR_TYPE_SLOTS; ++t) {
+        if (eval_stats.count[t] == 0) continue;
+        double mean = eval_stats.samples[t] == 0 ? 0.0
+                    : (double)eval_stats.cycles[t] / eval_stats.samples[t];
+        os << std::left << std::setw(18) << exprTypeName((ExprType)t) << std::right
+           << std::setw(14) << eval_stats.count[t]
+           << std::setw(7) << std::fixed << std::setprecision(1)
+           << 100.0 * eval_stats.count[t] / total << '%'
+           << std::setw(14) << std::setprecision(0) << mean << '\n';
+    }
+    os << "total evaluations: " << total << '\n';
+}
+
+// Names are Scheme identifiers, so only quotes and backslashes need escaping
+static void writeJsonString(std::ostream &os, const char *s) {
+    os << '"';
+    for (; *s; ++s) {
+        if (*s == '"' || *s == '\\') os << '\\';
+        os << *s;
+    }
+    os << '"';
+}
+
+void writeEvalStatsJson(std::ostream &os) {
+    os << "{\"sample_period\":" << EVAL_STATS_SAMPLE_PERIOD << ",\"types\":[";
+    bool first = true;
+    for (int t = 0; t < EXPR_TYPE_SLOTS; ++t) {
+        if (eval_stats.count[t] == 0) continue;
+        if (!first) os << ',';
+        first = false;
+        os << "{\"name\":";
+        writeJsonString(os, exprTypeName((ExprType)t));
+        os << ",\"count\":" << eval_stats.count[t]
+           << ",\"samples\":" << eval_stats.samples[t]
+           << ",\"sampled_cycles\":" << eval_stats.cycles[t]
+           << ",\"log2_cycle_histogram\":[";
+        for (int b = 0; b < EVAL_STATS_BUCKETS; ++b) {
+            if (b != 0) os << ',';
+            os << eval_stats.histogram[t][b];
+        }
+        os << "]}";
+    }
+    os << "]}\n";
+}
@@ -0,0 +1,67 @@
+#ifndef STATS_HPP
+#define STATS_HPP
+
+/**
+ * @file stats.hpp
+ * @brief Per-ExprType evaluation counters and cycle histograms (--stats)
+ *
+ * Each eval entry point opens an EVAL_STATS_SCOPE, which also maintains
+ * the expression --alloc-profile attributes allocations to. When the
+ * feature is compiled out (SCHEME_EVAL_STATS undefined) the macro expands
+ * to nothing and costs neither time nor native stack. When compiled in but
+ * not enabled at run time it costs two predictable branches; when enabled
+ * it counts every evaluation and samples one in EVAL_STATS_SAMPLE_PERIOD of
+ * them with the cycle counter.
+ */
+
+#include "Def.hpp"
+#include "heap.hpp"
+#include <ostream>
+
+const int EXPR_TYPE_SLOTS = 128;           ///< Upper bound on ExprType values
+const int EVAL_STATS_BUCKETS = 32;         ///< log2 buckets of sampled cycles
+const unsigned EVAL_STATS_SAMPLE_PERIOD = 16;
+
+struct EvalStats {
+    unsigned long long count[EXPR_TYPE_SLOTS];
+    unsigned long long samples[EXPR_TYPE_SLOTS];
+    unsigned long long cycles[EXPR_TYPE_SLOTS];     ///< Sum over sampled evaluations
+    unsigned long long histogram[EXPR_TYPE_SLOTS][EVAL_STATS_BUCKETS];
+};
+
+extern bool eval_stats_enabled;
+extern EvalStats eval_stats;
+
+unsigned long long readCycles();
+void recordEvalSample(ExprType, unsigned long long);
+const char *exprTypeName(ExprType);
+void printEvalStats(std::ostream &);
+void writeEvalStatsJson(std::ostream &);
+
+/**
+ * @brief RAII probe counting one evaluation and sampling its inclusive cycles
+ */
+class EvalStatsScope {
+    ExprType type;
+    unsigned long long start;   ///< 0 when this evaluation is not sampled
+public:
+    explicit EvalStatsScope(ExprType t) : type(t), start(0) {
+        if (!eval_stats_enabled) return;
+        if (++eval_stats.count[t] % EVAL_STATS_SAMPLE_PERIOD == 0) {
+            start = readCycles();
+        }
+    }
+    ~EvalStatsScope() {
+        if (start != 0) {
+            recordEvalSample(type, readCycles() - start);
+        }
+    }
+};
+
+#ifdef SCHEME_EVAL_STATS
+#define EVAL_STATS_SCOPE() AllocExprScope alloc_expr_scope(this); EvalStatsScope eval_stats_scope(e_type)
+#else
+#define EVAL_STATS_SCOPE()
+#endif
+
+#endif // STATS_HPP
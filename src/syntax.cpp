@@ -1,5 +1,6 @@
 #include "syntax.hpp"
 #include <cstring>
+#include <cstdlib>
 #include <vector>
 
 Syntax::Syntax(SyntaxBase *stx) : ptr(stx) {}
@@ -17,6 +18,11 @@ void RationalSyntax::show(std::ostream &os) {
   os << numerator << "/" << denominator;
 }
 
+RealSyntax::RealSyntax(double x) : x(x) {}
+void RealSyntax::show(std::ostream &os) {
+  os << x;
+}
+
 void TrueSyntax::show(std::ostream &os) {
   os << "#t";
 }
@@ -35,7 +41,7 @@ void StringSyntax::show(std::ostream &os) {
     os << "\"" << s << "\"";
 }
 
-List::List() {}
+List::List() : line(0) {}
 void List::show(std::ostream &os) {
     os << '(';
     for (auto stx : stxs) {
@@ -45,11 +51,15 @@ void List::show(std::ostream &os) {
     os << ')';
 }
 
+// Line of the reader's current position, used to label anonymous lambdas
+int syntax_line = 1;
+
 std::istream &readSpace(std::istream &is) {
   while (true) {
     // Skip whitespace characters
     while (isspace(is.peek()))
-      is.get();
+      if (is.get() == '\n')
+        syntax_line++;
     
     // Check if it's a comment
     if (is.peek() == ';') {
@@ -121,6 +131,32 @@ bool tryParseRational(const std::string &s, int &numerator, int &denominator) {
   return true;
 }
 
+// Helper function to try parsing as decimal (inexact) number, e.g. 1.5,
+// -.25 or 6.02e23. At least one digit is required, so "." and "..." remain
+// symbols.
+bool tryParseReal(const std::string &s, double &result) {
+  size_t i = 0;
+  bool digits = false;
+  if (i < s.size() && (s[i] == '+' || s[i] == '-')) i++;
+  while (i < s.size() && isdigit(s[i])) { i++; digits = true; }
+  bool point = i < s.size() && s[i] == '.';
+  if (point) {
+    i++;
+    while (i < s.size() && isdigit(s[i])) { i++; digits = true; }
+  }
+  if (!digits) return false;
+  bool exponent = i < s.size() && (s[i] == 'e' || s[i] == 'E');
+  if (exponent) {
+    i++;
+    if (i < s.size() && (s[i] == '+' || s[i] == '-')) i++;
+    if (i == s.size() || !isdigit(s[i])) return false;
+    while (i < s.size() && isdigit(s[i])) i++;
+  }
+  if (i != s.size() || (!point && !exponent)) return false;
+  result = strtod(s.c_str(), nullptr);
+  return true;
+}
+
 // Helper function to create identifier/symbol syntax
 Syntax createIdentifierSyntax(const std::string &s) {
   if (s == "#t")
@@ -155,6 +191,9 @@ Syntax readItem(std::istream &is) {
     std::string str;
     while (is.peek() != '"' && is.peek() != EOF) {
       char c = is.get();
+      if (c == '\n') {
+        syntax_line++;
+      }
       if (c == '\\') {
         // Handle escape characters
         char next = is.get();
@@ -202,15 +241,23 @@ Syntax readItem(std::istream &is) {
     return Syntax(new Number(number_value));
   }
   
+  // Try parsing as decimal
+  double real_value;
+  if (tryParseReal(s, real_value)) {
+    return Syntax(new RealSyntax(real_value));
+  }
+  
   // Not a number, treat as identifier/symbol
   return createIdentifierSyntax(s);
 }
 
 Syntax readList(std::istream &is) {
     List *stx = new List();
-    while (readSpace(is).peek() != ')' && readSpace(is).peek() != ')')
+    stx->line = syntax_line;
+    // An unterminated list ends at end of input instead of reading it forever
+    while (readSpace(is).peek() != ')' && is.peek() != ']' && is.peek() != EOF)
         stx->stxs.push_back(readItem(is));
-    is.get(); // ')'
+    is.get(); // ')' or ']'
     return Syntax(stx);
 }
 
@@ -36,6 +36,13 @@ struct RationalSyntax : SyntaxBase {
     virtual void show(std::ostream &) override;
 };
 
+struct RealSyntax : SyntaxBase {
+    double x;
+    RealSyntax(double);
+    virtual Expr parse(Assoc &) override;
+    virtual void show(std::ostream &) override;
+};
+
 struct TrueSyntax : SyntaxBase {
     // This will not match
     virtual Expr parse(Assoc &) override;
@@ -64,11 +71,15 @@ struct StringSyntax : SyntaxBase {
 
 struct List : SyntaxBase {
     std::vector<Syntax> stxs;
+    int line;   ///< Source line of the opening parenthesis, 0 if synthesized
     List();
     virtual Expr parse(Assoc &) override;
     virtual void show(std::ostream &) override;
 };
 
+extern int syntax_line;
+
+std::istream &readSpace(std::istream &);
 Syntax readSyntax(std::istream &);
 
 std::istream &operator>>(std::istream &, Syntax);
@@ -0,0 +1,105 @@
+/**
+ * @file trace.cpp
+ * @brief Implementation of the span ring buffer and its trace_event JSON
+ */
+
+#include "trace.hpp"
+#include <vector>
+#include <chrono>
+#include <cstdio>
+
+bool trace_enabled = false;
+unsigned long long trace_threshold_ns = 50000;
+
+namespace {
+
+struct TraceSpan {
+    const char *phase;
+    const std::string *procedure;
+    unsigned long long start_ns;
+    unsigned long long duration_ns;
+    long form;
+};
+
+std::vector<TraceSpan> ring;     ///< Allocated by setTraceCapacity
+size_t ring_next = 0;           ///< Slot written next
+bool ring_wrapped = false;
+unsigned long long trace_origin = 0;
+
+void writeName(std::ostream &os, const std::string &name) {
+    os << '"';
+    for (char c : name) {
+        if (c == '"' || c == '\\') {
+            os << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            os << escaped;
+        } else {
+            os << c;
+        }
+    }
+    os << '"';
+}
+
+void writeMicros(std::ostream &os, unsigned long long ns) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%llu.%03llu", ns / 1000, ns % 1000);
+    os << text;
+}
+
+} // namespace
+
+/**
+ * @brief Nanoseconds since the first call; never 0, which marks inactive spans
+ */
+unsigned long long traceClock() {
+    unsigned long long now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    if (trace_origin == 0) {
+        trace_origin = now - 1;
+    }
+    return now - trace_origin;
+}
+
+void setTraceCapacity(size_t capacity) {
+    ring.assign(capacity, TraceSpan());
+    ring_next = 0;
+    ring_wrapped = false;
+}
+
+void recordTraceSpan(const char *phase, const std::string *procedure,
+                     unsigned long long start, unsigned long long duration, long form) {
+    ring[ring_next] = TraceSpan{phase, procedure, start, duration, form};
+    if (++ring_next == ring.size()) {
+        ring_next = 0;
+        ring_wrapped = true;
+    }
+}
+
+void writeTrace(std::ostream &os) {
+    size_t count = ring_wrapped ? ring.size() : ring_next;
+    size_t first = ring_wrapped ? ring_next : 0;
+    os << "{\"traceEvents\":[";
+    for (size_t i = 0; i < count; ++i) {
+        const TraceSpan &span = ring[(first + i) % ring.size()];
+        os << (i == 0 ? "\n" : ",\n") << "{\"name\":";
+        if (span.procedure != nullptr) {
+            writeName(os, *span.procedure);
+            os << ",\"cat\":\"call\"";
+        } else {
+            writeName(os, span.phase);
+            os << ",\"cat\":\"repl\"";
+        }
+        os << ",\"ph\":\"X\",\"ts\":";
+        writeMicros(os, span.start_ns);
+        os << ",\"dur\":";
+        writeMicros(os, span.duration_ns);
+        os << ",\"pid\":1,\"tid\":1";
+        if (span.form >= 0) {
+            os << ",\"args\":{\"form\":" << span.form << "}";
+        }
+        os << "}";
+    }
+    os << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
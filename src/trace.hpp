@@ -0,0 +1,53 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+/**
+ * @file trace.hpp
+ * @brief Timeline of evaluation spans in Chrome trace_event format (--trace)
+ *
+ * The REPL opens a span for each top-level form and for its parse and eval
+ * phases; closure calls open one too, but it is kept only when the call took
+ * at least the --trace-threshold-us duration. Finished spans go into a ring
+ * buffer of fixed capacity, so a long run keeps its most recent spans. At exit
+ * the buffer is written as "complete" (ph "X") events, which Perfetto and
+ * chrome://tracing display as nested begin/end bars.
+ */
+
+#include <string>
+#include <ostream>
+
+const size_t TRACE_CAPACITY = 1 << 16;   ///< Spans kept by the ring buffer
+
+extern bool trace_enabled;
+extern unsigned long long trace_threshold_ns;
+
+unsigned long long traceClock();
+void setTraceCapacity(size_t);
+void recordTraceSpan(const char *, const std::string *, unsigned long long, unsigned long long, long);
+void writeTrace(std::ostream &);
+
+/**
+ * @brief RAII span; records nothing when tracing is disabled
+ *
+ * Phase spans are named by a string literal and always kept. Call spans are
+ * named by the procedure's interned name and dropped below the threshold.
+ */
+class TraceScope {
+    const char *phase;
+    const std::string *procedure;
+    long form;                  ///< Top-level form number, -1 for calls
+    unsigned long long start;   ///< 0 when inactive
+public:
+    TraceScope(const char *p, long f)
+        : phase(p), procedure(nullptr), form(f), start(trace_enabled ? traceClock() : 0) {}
+    explicit TraceScope(const std::string *name)
+        : phase(nullptr), procedure(name), form(-1), start(trace_enabled ? traceClock() : 0) {}
+    ~TraceScope() {
+        if (start == 0) return;
+        unsigned long long duration = traceClock() - start;
+        if (procedure != nullptr && duration < trace_threshold_ns) return;
+        recordTraceSpan(phase, procedure, start, duration, form);
+    }
+};
+
+#endif // TRACE_HPP
@@ -7,12 +7,33 @@
  */
 
 #include "value.hpp"
+#include "heap.hpp"
+#include <unordered_map>
+#include <algorithm>
+#include <set>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
 
 // ============================================================================
 // Base ValueBase Implementation
 // ============================================================================
 
-ValueBase::ValueBase(ValueType vt) : v_type(vt) {}
+ValueBase::ValueBase(ValueType vt) : v_type(vt) {
+    if (heap_accounting_enabled) heapTrack(vt, true);
+}
+
+ValueBase::~ValueBase() {
+    if (heap_accounting_enabled) heapTrack(v_type, false);
+}
+
+void *ValueBase::operator new(size_t size) {
+    return heapAllocate(size);
+}
+
+void ValueBase::operator delete(void *p, size_t size) {
+    heapRelease(p, size);
+}
 
 void ValueBase::showCdr(std::ostream &os) {
     os << " . ";
@@ -24,7 +45,17 @@ void ValueBase::showCdr(std::ostream &os) {
 // Value Smart Pointer Implementation
 // ============================================================================
 
-Value::Value(ValueBase *ptr) : ptr(ptr) {}
+// With heap accounting the reference count is allocated through
+// HeapAllocator to count it too
+Value::Value(ValueBase *ptr) {
+    if (ptr == nullptr) return;
+    if (heap_accounting_enabled) {
+        this->ptr = std::shared_ptr<ValueBase>(ptr, std::default_delete<ValueBase>(),
+                                               HeapAllocator<ValueBase>());
+    } else {
+        this->ptr = std::shared_ptr<ValueBase>(ptr);
+    }
+}
 
 ValueBase* Value::operator->() const { 
     return ptr.get(); 
@@ -42,14 +73,68 @@ void Value::show(std::ostream &os) {
     ptr->show(os);
 }
 
+// ============================================================================
+// Iterative Deallocation
+// ============================================================================
+
+// Destroying the last reference to a long list would otherwise recurse once
+// per cell (~Pair releasing its cdr, and so on). Destructors of linked
+// objects instead hand their uniquely owned successors to a pending list,
+// and the outermost destructor drains it in a loop, so freeing a structure
+// takes constant native stack regardless of its length or depth.
+static thread_local std::vector<std::shared_ptr<void>> pending_releases;
+static thread_local bool draining_releases = false;
+
+template <typename T>
+static void deferRelease(std::shared_ptr<T> &p) {
+    if (p && p.use_count() == 1) {
+        pending_releases.push_back(std::move(p));
+    }
+}
+
+static void drainReleases() {
+    if (draining_releases) return;
+    draining_releases = true;
+    while (!pending_releases.empty()) {
+        std::shared_ptr<void> next = std::move(pending_releases.back());
+        pending_releases.pop_back();
+        next.reset();
+    }
+    draining_releases = false;
+}
+
 // ============================================================================
 // Environment (Association List) Implementation
 // ============================================================================
 
 AssocList::AssocList(const std::string &x, const Value &v, Assoc &next)
-    : x(x), v(v), next(next) {}
+    : x(x), v(v), next(next) {
+    if (heap_accounting_enabled) heapTrack(HEAP_ENVIRONMENT, true);
+}
 
-Assoc::Assoc(AssocList *x) : ptr(x) {}
+AssocList::~AssocList() {
+    deferRelease(v.ptr);
+    deferRelease(next.ptr);
+    drainReleases();
+    if (heap_accounting_enabled) heapTrack(HEAP_ENVIRONMENT, false);
+}
+
+void *AssocList::operator new(size_t size) {
+    return heapAllocate(size);
+}
+
+void AssocList::operator delete(void *p, size_t size) {
+    heapRelease(p, size);
+}
+
+Assoc::Assoc(AssocList *x) {
+    if (x == nullptr) return;
+    if (heap_accounting_enabled) {
+        ptr = std::shared_ptr<AssocList>(x, std::default_delete<AssocList>(), HeapAllocator<AssocList>());
+    } else {
+        ptr = std::shared_ptr<AssocList>(x);
+    }
+}
 
 AssocList* Assoc::operator->() const { 
     return ptr.get(); 
@@ -63,6 +148,8 @@ AssocList* Assoc::get() const {
     return ptr.get(); 
 }
 
+Assoc *interaction_env = nullptr;
+
 Assoc empty() {
     return Assoc(nullptr);
 }
@@ -89,6 +176,21 @@ Value find(const std::string &x, Assoc &l) {
     return Value(nullptr);
 }
 
+/**
+ * @brief Returns the frame binding x, or nullptr when x is unbound
+ *
+ * Unlike find, a frame whose value is still the placeholder of a pending
+ * define counts as a binding, so the caller can store into it directly.
+ */
+AssocList *findBinding(const std::string &x, Assoc &l) {
+    for (AssocList *frame = l.get(); frame != nullptr; frame = frame->next.get()) {
+        if (x == frame->x) {
+            return frame;
+        }
+    }
+    return nullptr;
+}
+
 // ============================================================================
 // Simple Value Types Implementation
 // ============================================================================
@@ -157,6 +259,44 @@ Value RationalV(int num, int den) {
     return Value(new Rational(num, den));
 }
 
+// Real
+Real::Real(double x) : ValueBase(V_REAL), x(x) {}
+
+// Prints the shortest decimal that reads back as the same double, always
+// with a decimal point so that the value reads back as inexact
+void Real::show(std::ostream &os) {
+    if (std::isnan(x)) {
+        os << "+nan.0";
+        return;
+    }
+    if (std::isinf(x)) {
+        os << (x > 0 ? "+inf.0" : "-inf.0");
+        return;
+    }
+    // Shortest digits that read back as x, in fixed notation unless the
+    // exponent is far out: 20.0 rather than 2e+01
+    char buf[48];
+    int precision = 1;
+    for (;; ++precision) {
+        snprintf(buf, sizeof(buf), "%.*e", precision - 1, x);
+        if (precision == 17 || strtod(buf, nullptr) == x) break;
+    }
+    int exponent = atoi(strchr(buf, 'e') + 1);
+    if (exponent >= -7 && exponent < 21) {
+        snprintf(buf, sizeof(buf), "%.*f", std::max(precision - 1 - exponent, 0), x);
+    } else {
+        snprintf(buf, sizeof(buf), "%.*g", precision, x);
+    }
+    os << buf;
+    if (strpbrk(buf, ".e") == nullptr) {
+        os << ".0";
+    }
+}
+
+Value RealV(double x) {
+    return Value(new Real(x));
+}
+
 // Boolean
 Boolean::Boolean(bool b) : ValueBase(V_BOOL), b(b) {}
 
@@ -175,21 +315,72 @@ void Symbol::show(std::ostream &os) {
     os << s;
 }
 
+// Symbols are interned: every occurrence of a name shares one object, so
+// symbol comparison is a pointer comparison.
 Value SymbolV(const std::string &s) {
-    return Value(new Symbol(s));
+    static std::unordered_map<std::string, Value> symbols;
+    auto it = symbols.find(s);
+    if (it != symbols.end()) {
+        return it->second;
+    }
+    Value sym(new Symbol(s));
+    symbols.insert(std::make_pair(s, sym));
+    return sym;
 }
 
 // String
-String::String(const std::string &s) : ValueBase(V_STRING), s(s) {}
+// Releases a character buffer together with its charge
+struct StringBufferDeleter {
+    size_t bytes;
+    void operator()(const std::string *text) const {
+        delete text;
+        heapRefund(bytes);
+    }
+};
+
+/**
+ * @brief A fresh character buffer for a string value, charged to the heap
+ */
+std::shared_ptr<const std::string> stringBuffer(std::string s) {
+    if (!heap_accounting_enabled) {
+        return std::make_shared<const std::string>(std::move(s));
+    }
+    size_t bytes = sizeof(std::string) + s.capacity() + 1;
+    heapCharge(bytes);
+    const std::string *text;
+    try {
+        text = new std::string(std::move(s));
+    } catch (...) {
+        heapRefund(bytes);
+        throw;
+    }
+    return std::shared_ptr<const std::string>(text, StringBufferDeleter{bytes}, HeapAllocator<std::string>());
+}
+
+String::String(const std::string &s)
+    : ValueBase(V_STRING), text(stringBuffer(s)) {}
+
+String::String(const std::shared_ptr<const std::string> &text)
+    : ValueBase(V_STRING), text(text) {}
+
+const std::string &String::str() const {
+    return *text;
+}
 
 void String::show(std::ostream &os) {
-    os << "\"" << s << "\"";
+    os << '"';
+    os.write(text->data(), text->size());
+    os << '"';
 }
 
 Value StringV(const std::string &s) {
     return Value(new String(s));
 }
 
+Value StringV(const std::shared_ptr<const std::string> &text) {
+    return Value(new String(text));
+}
+
 // ============================================================================
 // Special Value Types Implementation
 // ============================================================================
@@ -226,7 +417,13 @@ Value TerminateV() {
 
 // Pair
 Pair::Pair(const Value &car, const Value &cdr) 
-    : ValueBase(V_PAIR), car(car), cdr(cdr) {}
+    : ValueBase(V_PAIR), car(car), cdr(cdr), constant(false) {}
+
+Pair::~Pair() {
+    deferRelease(cdr.ptr);
+    deferRelease(car.ptr);
+    drainReleases();
+}
 
 void Pair::show(std::ostream &os) {
     os << '(' << car;
@@ -242,16 +439,252 @@ Value PairV(const Value &car, const Value &cdr) {
     return Value(new Pair(car, cdr));
 }
 
+// MultipleValues
+MultipleValues::MultipleValues(const std::vector<Value> &vals) : ValueBase(V_VALUES), values(vals) {}
+
+void MultipleValues::show(std::ostream &os) {
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (i > 0) os << ' ';
+        os << values[i];
+    }
+}
+
+Value MultipleValuesV(const std::vector<Value> &vals) {
+    return Value(new MultipleValues(vals));
+}
+
+// Environment
+Environment::Environment(Assoc *env) : ValueBase(V_ENVIRONMENT), env(env) {}
+
+void Environment::show(std::ostream &os) {
+    os << "#<environment>";
+}
+
+Value EnvironmentV(Assoc *env) {
+    return Value(new Environment(env));
+}
+
+// Record
+// operator delete only receives sizeof(Record), so ~Record hands over the
+// size of the whole block, slots included
+static size_t releasing_record_bytes = 0;
+
+static size_t recordBytes(size_t slots) {
+    return sizeof(Record) + slots * sizeof(Value);
+}
+
+Record::Record(const std::shared_ptr<const RecordType> &type) : ValueBase(V_RECORD), type(type) {
+    Value *slot = slots();
+    for (size_t i = 0; i < size(); ++i) {
+        new (slot + i) Value(nullptr);
+    }
+}
+
+Record::~Record() {
+    Value *slot = slots();
+    for (size_t i = 0; i < size(); ++i) {
+        deferRelease(slot[i].ptr);
+        slot[i].~Value();
+    }
+    drainReleases();
+    // Set last: draining may delete other records
+    releasing_record_bytes = recordBytes(size());
+}
+
+size_t Record::size() const {
+    return type->fields.size();
+}
+
+Value *Record::slots() {
+    return reinterpret_cast<Value*>(this + 1);
+}
+
+const Value *Record::slots() const {
+    return reinterpret_cast<const Value*>(this + 1);
+}
+
+void *Record::operator new(size_t size, const RecordType &type) {
+    return heapAllocate(size + type.fields.size() * sizeof(Value));
+}
+
+void Record::operator delete(void *p, const RecordType &type) {
+    heapRelease(p, recordBytes(type.fields.size()));
+}
+
+void Record::operator delete(void *p, size_t) {
+    heapRelease(p, releasing_record_bytes);
+}
+
+void Record::show(std::ostream &os) {
+    // A type written <point> prints as #<point x: 1 y: 2>
+    const std::string &name = type->name;
+    bool bracketed = name.size() > 2 && name[0] == '<' && name[name.size() - 1] == '>';
+    os << "#<" << (bracketed ? name.substr(1, name.size() - 2) : name);
+    Value *slot = slots();
+    for (size_t i = 0; i < size(); ++i) {
+        os << ' ' << type->fields[i] << ": " << slot[i];
+    }
+    os << '>';
+}
+
+Value RecordV(const std::shared_ptr<const RecordType> &type) {
+    return Value(new (*type) Record(type));
+}
+
+// MemoTable
+// Live tables are registered so that the heap ceiling can drop their caches
+static std::set<MemoTable*> memo_tables;
+
+MemoTable::MemoTable(size_t capacity) : capacity(capacity), charged(0), hits(0), misses(0) {
+    memo_tables.insert(this);
+}
+
+MemoTable::~MemoTable() {
+    memo_tables.erase(this);
+    heapRefund(charged);
+}
+
+void MemoTable::clear() {
+    index.clear();
+    entries.clear();
+    heapRefund(charged);
+    charged = 0;
+}
+
+// Heap bytes of one entry: its list node, its hash node and bucket, and the
+// two copies of the key
+static size_t entryBytes(const MemoTable::Key &key) {
+    return sizeof(MemoTable::Entries::value_type) + 2 * sizeof(void*) +
+           sizeof(std::pair<const MemoTable::Key, MemoTable::Entries::iterator>) + 3 * sizeof(void*) +
+           2 * key.size() * sizeof(Value);
+}
+
+void clearMemoTables() {
+    for (auto table : memo_tables) {
+        table->clear();
+    }
+}
+
+size_t MemoTable::KeyHash::operator()(const Key &key) const {
+    size_t h = key.size();
+    for (const auto &v : key) {
+        size_t k;
+        switch (v->v_type) {
+            case V_INT: k = std::hash<int>()(static_cast<Integer*>(v.get())->n); break;
+            case V_RATIONAL: k = std::hash<int>()(static_cast<Rational*>(v.get())->numerator) * 31 +
+                                 std::hash<int>()(static_cast<Rational*>(v.get())->denominator); break;
+            case V_REAL: k = std::hash<double>()(static_cast<Real*>(v.get())->x); break;
+            case V_BOOL: k = static_cast<Boolean*>(v.get())->b ? 1 : 2; break;
+            case V_STRING: k = std::hash<std::string>()(static_cast<String*>(v.get())->str()); break;
+            case V_NULL: k = 3; break;
+            case V_VOID: k = 4; break;
+            default: k = std::hash<ValueBase*>()(v.get()); break;
+        }
+        h ^= k + 0x9e3779b9 + (h << 6) + (h >> 2);
+    }
+    return h;
+}
+
+bool MemoTable::KeyEqual::operator()(const Key &a, const Key &b) const {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        ValueBase *x = a[i].get();
+        ValueBase *y = b[i].get();
+        if (x == y) continue;
+        if (x->v_type != y->v_type) return false;
+        switch (x->v_type) {
+            case V_INT:
+                if (static_cast<Integer*>(x)->n != static_cast<Integer*>(y)->n) return false;
+                break;
+            case V_RATIONAL:
+                if (static_cast<Rational*>(x)->numerator != static_cast<Rational*>(y)->numerator ||
+                    static_cast<Rational*>(x)->denominator != static_cast<Rational*>(y)->denominator) return false;
+                break;
+            case V_REAL:
+                if (static_cast<Real*>(x)->x != static_cast<Real*>(y)->x) return false;
+                break;
+            case V_BOOL:
+                if (static_cast<Boolean*>(x)->b != static_cast<Boolean*>(y)->b) return false;
+                break;
+            case V_STRING:
+                if (static_cast<String*>(x)->str() != static_cast<String*>(y)->str()) return false;
+                break;
+            case V_NULL:
+            case V_VOID:
+                break;
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+bool MemoTable::lookup(const Key &key, Value &result) {
+    auto it = index.find(key);
+    if (it == index.end()) {
+        ++misses;
+        return false;
+    }
+    ++hits;
+    if (capacity != 0) {
+        entries.splice(entries.begin(), entries, it->second);
+    }
+    result = it->second->second;
+    return true;
+}
+
+void MemoTable::insert(const Key &key, const Value &result) {
+    auto it = index.find(key);
+    if (it != index.end()) {
+        it->second->second = result;
+        return;
+    }
+    // Charged first: reclaiming to make room may clear this table
+    if (heap_accounting_enabled) {
+        size_t bytes = entryBytes(key);
+        heapCharge(bytes);
+        charged += bytes;
+    }
+    if (capacity != 0 && index.size() >= capacity) {
+        if (heap_accounting_enabled) {
+            size_t evicted = entryBytes(entries.back().first);
+            heapRefund(evicted);
+            charged -= evicted;
+        }
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
+    entries.push_front(std::make_pair(key, result));
+    index.insert(std::make_pair(key, entries.begin()));
+}
+
 // Procedure
-Procedure::Procedure(const std::vector<std::string> &xs, const Expr &e, const Assoc &env)
-    : ValueBase(V_PROC), parameters(xs), e(e), env(env) {}
+Procedure::Procedure(const std::shared_ptr<const CodeObject> &code, const Assoc &env)
+    : ValueBase(V_PROC), code(code), env(env) {}
+
+Procedure::~Procedure() {
+    deferRelease(env.ptr);
+    drainReleases();
+}
 
 void Procedure::show(std::ostream &os) {
     os << "#<procedure>";
 }
 
-Value ProcedureV(const std::vector<std::string> &xs, const Expr &e, const Assoc &env) {
-    return Value(new Procedure(xs, e, env));
+Value ProcedureV(const std::shared_ptr<const CodeObject> &code, const Assoc &env) {
+    return Value(new Procedure(code, env));
+}
+
+// Primitive
+Primitive::Primitive(ExprType op, const Expr &node)
+    : ValueBase(V_PRIMITIVE), op(op), node(node) {}
+
+void Primitive::show(std::ostream &os) {
+    os << "#<procedure>";
+}
+
+Value PrimitiveV(ExprType op, const Expr &node) {
+    return Value(new Primitive(op, node));
 }
 
 // ============================================================================
@@ -14,6 +14,8 @@
 #include <memory>
 #include <cstring>
 #include <vector>
+#include <list>
+#include <unordered_map>
 
 // ============================================================================
 // Base classes and smart pointer wrappers
@@ -27,7 +29,9 @@ struct ValueBase {
     ValueBase(ValueType);
     virtual void show(std::ostream &) = 0;
     virtual void showCdr(std::ostream &);
-    virtual ~ValueBase() = default;
+    virtual ~ValueBase();
+    static void *operator new(size_t);       ///< Accounted in heap.hpp
+    static void operator delete(void *, size_t);
 };
 
 /**
@@ -65,6 +69,9 @@ struct AssocList {
     Value v;            ///< Variable value
     Assoc next;         ///< Next binding in the chain
     AssocList(const std::string &, const Value &, Assoc &);
+    ~AssocList();
+    static void *operator new(size_t);       ///< Accounted in heap.hpp
+    static void operator delete(void *, size_t);
 };
 
 // Environment operations
@@ -72,6 +79,9 @@ Assoc empty();
 Assoc extend(const std::string&, const Value &, Assoc &);
 void modify(const std::string&, const Value &, Assoc &);
 Value find(const std::string &, Assoc &);
+AssocList *findBinding(const std::string &, Assoc &);
+
+extern Assoc *interaction_env;   ///< Global environment of the running REPL, for eval
 
 // ============================================================================
 // Simple Value Types
@@ -107,6 +117,16 @@ struct Rational : ValueBase {
 };
 Value RationalV(int, int);
 
+/**
+ * @brief Inexact real number value (IEEE double)
+ */
+struct Real : ValueBase {
+    double x;
+    Real(double);
+    virtual void show(std::ostream &) override;
+};
+Value RealV(double);
+
 /**
  * @brief Boolean value
  */
@@ -129,13 +149,21 @@ Value SymbolV(const std::string &);
 
 /**
  * @brief String value
+ *
+ * The characters live in a reference-counted buffer that is never written
+ * once shared: string literals hand the same buffer to every evaluation, and
+ * operations that need different contents build a fresh buffer.
  */
 struct String : ValueBase {
-    std::string s;
+    std::shared_ptr<const std::string> text;  ///< Shared character buffer
     String(const std::string &);
+    String(const std::shared_ptr<const std::string> &);
+    const std::string &str() const;
     virtual void show(std::ostream &) override;
 };
 Value StringV(const std::string &);
+Value StringV(const std::shared_ptr<const std::string> &);
+std::shared_ptr<const std::string> stringBuffer(std::string);
 
 // ============================================================================
 // Special Value Types
@@ -170,23 +198,129 @@ Value TerminateV();
 struct Pair : ValueBase {
     Value car;  ///< First element
     Value cdr;  ///< Second element
+    bool constant;  ///< Part of a shared quoted literal; may not be mutated
     Pair(const Value &, const Value &);
+    ~Pair();
     virtual void show(std::ostream &) override;
     virtual void showCdr(std::ostream &) override;
 };
 Value PairV(const Value &, const Value &);
 
+/**
+ * @brief Layout shared by the records of one define-record-type
+ */
+struct RecordType {
+    std::string name;                   ///< Type name as written, e.g. <point>
+    std::vector<std::string> fields;    ///< Field names in slot order
+};
+
+/**
+ * @brief Record value: a type tag and a fixed number of slots
+ *
+ * The slots are stored inline, right after the object in the same heap
+ * block, so a record of n fields costs one allocation where the same data
+ * as a list costs n pairs. Records compare by identity under equal?.
+ */
+struct Record : ValueBase {
+    std::shared_ptr<const RecordType> type;
+    Record(const std::shared_ptr<const RecordType> &);
+    ~Record();
+    size_t size() const;
+    Value *slots();
+    const Value *slots() const;
+    virtual void show(std::ostream &) override;
+    static void *operator new(size_t, const RecordType &);      ///< Reserves the slots
+    static void operator delete(void *, const RecordType &);
+    static void operator delete(void *, size_t);
+};
+Value RecordV(const std::shared_ptr<const RecordType> &);
+
+/**
+ * @brief What (values ...) returns for other than exactly one value
+ *
+ * Up to four values travel in one object that the evaluator refills for
+ * every call (see claimValuesRegister). Once anything else keeps a result,
+ * for instance a memo table, that object is never refilled, so it can be
+ * received any number of times.
+ */
+struct MultipleValues : ValueBase {
+    std::vector<Value> values;
+    MultipleValues(const std::vector<Value> &);
+    virtual void show(std::ostream &) override;
+};
+Value MultipleValuesV(const std::vector<Value> &);
+
+/**
+ * @brief First-class environment, as returned by (interaction-environment)
+ *
+ * Refers to the REPL's global environment variable rather than a frame, so
+ * definitions made through eval extend the environment everyone sees.
+ */
+struct Environment : ValueBase {
+    Assoc *env;
+    Environment(Assoc *);
+    virtual void show(std::ostream &) override;
+};
+Value EnvironmentV(Assoc *);
+
+/**
+ * @brief Result cache of a memoized procedure, keyed on argument tuples
+ *
+ * Numbers, booleans and strings are keyed by value; everything
+ * else (including interned symbols) by identity. With a non-zero capacity the
+ * least recently used entry is evicted once the table is full. Entries are
+ * charged to the heap by an estimate of their container nodes and keys.
+ */
+struct MemoTable {
+    typedef std::vector<Value> Key;
+    struct KeyHash {
+        size_t operator()(const Key &) const;
+    };
+    struct KeyEqual {
+        bool operator()(const Key &, const Key &) const;
+    };
+    typedef std::list<std::pair<Key, Value>> Entries;
+
+    Entries entries;    ///< Cached results, most recently used first
+    std::unordered_map<Key, Entries::iterator, KeyHash, KeyEqual> index;
+    size_t capacity;    ///< Maximum number of entries, 0 for unbounded
+    size_t charged;     ///< Bytes charged to the heap for the entries
+    long long hits;
+    long long misses;
+    MemoTable(size_t);
+    ~MemoTable();
+    void clear();
+    bool lookup(const Key &, Value &);
+    void insert(const Key &, const Value &);
+};
+
 /**
  * @brief Procedure (function) value
  */
 struct Procedure : ValueBase {
-    std::vector<std::string> parameters;   ///< Parameter names
-    Expr e;                                ///< Function body expression
+    std::shared_ptr<const CodeObject> code;   ///< Parameters, body and name
     Assoc env;                             ///< Closure environment
-    Procedure(const std::vector<std::string> &, const Expr &, const Assoc &);
+    std::shared_ptr<MemoTable> memo;       ///< Result cache, null unless memoized
+    Procedure(const std::shared_ptr<const CodeObject> &, const Assoc &);
+    ~Procedure();
+    virtual void show(std::ostream &) override;
+};
+Value ProcedureV(const std::shared_ptr<const CodeObject> &, const Assoc &);
+
+/**
+ * @brief Built-in procedure used as a first-class value
+ *
+ * Created when a primitive name is evaluated as a variable, e.g. the `car` in
+ * (map car lst). Holds an operator node whose evalRator is invoked directly
+ * with already-evaluated arguments.
+ */
+struct Primitive : ValueBase {
+    ExprType op;                           ///< Primitive operation
+    Expr node;                             ///< Operator node (operands unused)
+    Primitive(ExprType, const Expr &);
     virtual void show(std::ostream &) override;
 };
-Value ProcedureV(const std::vector<std::string> &, const Expr &, const Assoc &);
+Value PrimitiveV(ExprType, const Expr &);
 
 // ============================================================================
 // Utility Functions